@@ -0,0 +1,259 @@
+// Benchmarks the solver on random puzzles that are known to be solvable
+// (see puzzle_generator.h).  Build it from the puzzle directory, with
+// every source file but main.cpp:
+//
+//   g++ -O2 -std=c++11 -pthread -o carcassonne_benchmark benchmark/benchmark.cpp $(ls *.cpp | grep -v main.cpp)
+//
+// A family of puzzles is one value from each of the lists given for
+// -tiles, -boards, -duplicates and -rotations.  Every puzzle of every
+// family is solved by each engine in each mode, and every run writes one
+// line of JSON to std::cout, e.g.
+//
+//   {"tiles":8,"rows":4,"columns":4,"duplicates":0.25,"rotations":false,
+//    "puzzle":0,"seed":1,"engine":"cells","mode":"all","solutions":3,
+//    "complete":true,"nodes":412,"seconds":0.00031,
+//    "first_solution_seconds":0.00008,"nodes_per_second":1329032}
+//
+// (on one line).  "duplicates" is the ratio the puzzle came out with, the
+// one asked for is only aimed at.  A puzzle can be made again on its own
+// with -puzzles 1 -seed <its seed>, and -write saves them all as puzzle
+// files for the solver.  With -time_limit, a run that takes longer stops
+// there and is marked "complete":false.
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../MersenneTwister.h"
+#include "../tile.h"
+#include "../location.h"
+#include "../board.h"
+#include "../inventory.h"
+#include "../solver.h"
+#include "../solution_set.h"
+#include "../dlx.h"
+#include "../puzzle_generator.h"
+
+
+// read by the tile and board code, the boards are never printed here
+int GLOBAL_TILE_SIZE = 11;
+
+
+// ==========================================================================
+void usage(int argc, char *argv[]) {
+  std::cerr << "USAGE: " << std::endl;
+  std::cerr << "  " << argv[0] << "  [-tiles <n,...>]  [-boards <h>x<w>,...]  [-duplicates <ratio,...>]"
+            << "  [-rotations <0|1>,...]" << std::endl;
+  std::cerr << "  " << argv[0] << "  [-puzzles <n>]  [-seed <s>]  [-engines <tiles|cells|dlx>,...]"
+            << "  [-modes <first|all|count>,...]" << std::endl;
+  std::cerr << "  " << argv[0] << "  [-memo <megabytes>]  [-time_limit <seconds>]  [-write <directory>]" << std::endl;
+  exit(1);
+}
+
+
+// splits a comma separated list
+std::vector<std::string> Split_list(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream istr(list);
+  std::string item;
+  while (std::getline(istr, item, ',')) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+
+double Seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// ==========================================================================
+// Solves the puzzle with one engine in one mode and writes its line.
+void Run(const PuzzleFamily &family, int puzzle, unsigned long seed, double duplicates,
+         const std::vector<Tile*> &tiles, const TileInventory &inventory, int rows, int columns,
+         const std::string &engine, const std::string &mode, int memo_megabytes, double time_limit) {
+  Board board(rows, columns);
+  std::vector<Location> locations;
+  SearchStats stats;
+  stats.time_limit = time_limit;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  SolutionMode solution_mode = (mode == "first") ? FIRST_SOLUTION : (mode == "all") ? ALL_SOLUTIONS : COUNT_SOLUTIONS;
+  SolutionTally visitor(solution_mode, tiles, inventory, rows, columns);
+  if (engine == "dlx") {
+    ExactCoverSearch search(board, inventory);
+    search.setStats(&stats);
+    search.Search(locations, visitor);
+  } else if (engine == "cells") {
+    CellSearch search(board, inventory);
+    TranspositionTable memo(memo_megabytes);
+    if (memo_megabytes > 0) search.setMemo(&memo);
+    search.setStats(&stats);
+    search.Search(locations, visitor);
+  } else {
+    locations.assign(inventory.numTiles(), Location());
+    Can_place(board, inventory, locations, 0, visitor, &stats);
+  }
+  double seconds = Seconds_since(start);
+
+  std::cout << "{\"tiles\":" << family.num_tiles
+            << ",\"rows\":" << family.rows
+            << ",\"columns\":" << family.columns
+            << ",\"duplicates\":" << duplicates
+            << ",\"rotations\":" << (family.allow_rotations ? "true" : "false")
+            << ",\"puzzle\":" << puzzle
+            << ",\"seed\":" << seed
+            << ",\"engine\":\"" << engine << "\""
+            << ",\"mode\":\"" << mode << "\""
+            << ",\"solutions\":" << visitor.numSolutions()
+            << ",\"complete\":" << (stats.out_of_budget ? "false" : "true")
+            << ",\"nodes\":" << stats.nodes
+            << ",\"seconds\":" << seconds
+            << ",\"first_solution_seconds\":";
+  if (visitor.firstSeconds() < 0) std::cout << "null";
+  else std::cout << visitor.firstSeconds();
+  std::cout << ",\"nodes_per_second\":";
+  if (seconds > 0) std::cout << (long long)(stats.nodes / seconds);
+  else std::cout << "null";
+  std::cout << "}" << std::endl;
+}
+
+
+// ==========================================================================
+// Makes one puzzle of the family (saved if a directory is given) and runs
+// it through every engine and mode.
+void Benchmark_puzzle(const PuzzleFamily &family, int puzzle, unsigned long seed,
+                      const std::vector<std::string> &engines, const std::vector<std::string> &modes,
+                      int memo_megabytes, double time_limit, const std::string &directory) {
+  MTRand mtrand(seed);
+  std::vector<EdgeCode> codes;
+  GeneratePuzzle(family, mtrand, codes);
+  double duplicates = DuplicateRatio(codes, family.allow_rotations);
+
+  if (!directory.empty()) {
+    std::stringstream name;
+    name << directory << "/puzzle_" << family.num_tiles << "_" << family.rows << "x" << family.columns
+         << "_" << seed << (family.allow_rotations ? "_rotated" : "") << ".txt";
+    std::ofstream ostr(name.str().c_str());
+    if (!ostr) {
+      std::cerr << "ERROR: cannot write '" << name.str() << "'" << std::endl;
+      exit(1);
+    }
+    for (int t = 0; t < codes.size(); t++) {
+      ostr << "tile";
+      for (int side = NORTH; side <= WEST; side++) {
+        ostr << " " << edgeName(getEdge(codes[t], side));
+      }
+      ostr << "\n";
+    }
+  }
+
+  std::vector<Tile*> tiles;
+  for (int t = 0; t < codes.size(); t++) {
+    tiles.push_back(new Tile(codes[t]));
+  }
+  // set up as main.cpp does
+  TileInventory inventory(tiles, family.allow_rotations);
+  int rows = family.rows;
+  int columns = family.columns;
+  Prepare_search(inventory, rows, columns);
+
+  for (int e = 0; e < engines.size(); e++) {
+    for (int m = 0; m < modes.size(); m++) {
+      Run(family, puzzle, seed, duplicates, tiles, inventory, rows, columns, engines[e], modes[m], memo_megabytes,
+          time_limit);
+    }
+  }
+
+  for (int t = 0; t < tiles.size(); t++) {
+    delete tiles[t];
+  }
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+
+  std::vector<std::string> tile_counts = Split_list("6,8");
+  std::vector<std::string> boards = Split_list("4x4");
+  std::vector<std::string> duplicate_ratios = Split_list("0,0.5");
+  std::vector<std::string> rotations = Split_list("0,1");
+  std::vector<std::string> engines = Split_list("tiles,cells,dlx");
+  std::vector<std::string> modes = Split_list("first,all,count");
+  int num_puzzles = 3;
+  unsigned long seed = 1;
+  int memo_megabytes = 0;
+  double time_limit = 0;
+  std::string directory;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "ERROR: '" << arg << "' needs a value" << std::endl;
+      usage(argc,argv);
+    }
+    std::string value = argv[++i];
+    if (arg == "-tiles") tile_counts = Split_list(value);
+    else if (arg == "-boards") boards = Split_list(value);
+    else if (arg == "-duplicates") duplicate_ratios = Split_list(value);
+    else if (arg == "-rotations") rotations = Split_list(value);
+    else if (arg == "-engines") engines = Split_list(value);
+    else if (arg == "-modes") modes = Split_list(value);
+    else if (arg == "-puzzles") num_puzzles = atoi(value.c_str());
+    else if (arg == "-seed") seed = strtoul(value.c_str(), NULL, 10);
+    else if (arg == "-memo") memo_megabytes = atoi(value.c_str());
+    else if (arg == "-time_limit") time_limit = atof(value.c_str());
+    else if (arg == "-write") directory = value;
+    else {
+      std::cerr << "ERROR: unknown argument '" << arg << "'" << std::endl;
+      usage(argc,argv);
+    }
+  }
+  for (int e = 0; e < engines.size(); e++) {
+    if (engines[e] != "tiles" && engines[e] != "cells" && engines[e] != "dlx") {
+      std::cerr << "ERROR: unknown engine '" << engines[e] << "'" << std::endl;
+      usage(argc,argv);
+    }
+  }
+  for (int m = 0; m < modes.size(); m++) {
+    if (modes[m] != "first" && modes[m] != "all" && modes[m] != "count") {
+      std::cerr << "ERROR: unknown mode '" << modes[m] << "'" << std::endl;
+      usage(argc,argv);
+    }
+  }
+  if (num_puzzles < 1 || memo_megabytes < 0 || time_limit < 0) usage(argc,argv);
+
+  // every family, each puzzle with a seed of its own
+  for (int t = 0; t < tile_counts.size(); t++) {
+    for (int b = 0; b < boards.size(); b++) {
+      for (int d = 0; d < duplicate_ratios.size(); d++) {
+        for (int r = 0; r < rotations.size(); r++) {
+          PuzzleFamily family;
+          family.num_tiles = atoi(tile_counts[t].c_str());
+          family.duplicate_ratio = atof(duplicate_ratios[d].c_str());
+          family.allow_rotations = (rotations[r] == "1");
+          if (sscanf(boards[b].c_str(), "%dx%d", &family.rows, &family.columns) != 2 ||
+              family.rows < 1 || family.columns < 1 || family.num_tiles < 1) {
+            std::cerr << "ERROR: bad family " << tile_counts[t] << " tiles on " << boards[b] << std::endl;
+            usage(argc,argv);
+          }
+          if (family.num_tiles > family.rows * family.columns) {
+            std::cerr << "skipping " << family.num_tiles << " tiles, they do not fit on " << boards[b] << std::endl;
+            continue;
+          }
+          for (int p = 0; p < num_puzzles; p++) {
+            Benchmark_puzzle(family, p, seed++, engines, modes, memo_megabytes, time_limit, directory);
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -1,7 +1,11 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <vector>
 
+#include "MersenneTwister.h"
 #include "board.h"
 
 
@@ -12,10 +16,52 @@ extern int GLOBAL_TILE_SIZE;
 
 // ==========================================================================
 // CONSTRUCTOR
-Board::Board(int i, int j) {
-  board = std::vector<std::vector<Tile*> >
-    ( (unsigned int)i,
-      std::vector<Tile*>((unsigned int)j,NULL) );
+Board::Board(int i, int j) : rows(i), columns(j), keyed(false), key(0) {
+  stride = columns + 2;
+  offsets[NORTH] = -stride;
+  offsets[EAST] = 1;
+  offsets[SOUTH] = stride;
+  offsets[WEST] = -1;
+  clear();
+}
+
+
+// slots of a cell in zobrist_keys
+static const int PLACED_SLOT = 0;
+static const int BLOCKED_SLOT = 1;
+static int Need_slot(int side, int type) { return 2 + 3 * side + type; }
+
+
+// shared by every board, the border of the board looks like pasture
+Tile* Board::sentinel() {
+  static Tile border("pasture","pasture","pasture","pasture");
+  return &border;
+}
+
+
+// The same seed on every board, so keys can be compared between boards
+// of the same size.
+void Board::enableKeys() {
+  if (keyed) return;
+  MTRand mtrand(2017);
+  zobrist_keys = std::vector<unsigned long long>(board.size() * 14);
+  for (int k = 0; k < zobrist_keys.size(); k++) {
+    zobrist_keys[k] = (((unsigned long long)mtrand.randInt()) << 32) | mtrand.randInt();
+  }
+  keyed = true;
+  compute_key();
+}
+
+void Board::compute_key() {
+  key = 0;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < columns; c++) {
+      int cell = index(r,c);
+      if (isBlocked(cell)) key ^= zobrist(cell, BLOCKED_SLOT);
+      else if (board[cell] != NULL) key ^= zobrist(cell, PLACED_SLOT);
+      else key ^= needs_key(cell);
+    }
+  }
 }
 
 
@@ -24,7 +70,17 @@ Board::Board(int i, int j) {
 Tile* Board::getTile(int i, int j) const {
   assert (i >= 0 && i < numRows());
   assert (j >= 0 && j < numColumns());
-  return board[i][j];
+  Tile *t = board[index(i,j)];
+  return (t == sentinel()) ? NULL : t;
+}
+
+unsigned int Board::fitMask(int index, unsigned int orientations) const {
+  // spread the cell's masks over the 4 bytes, a byte of x is zero if that
+  // orientation fits
+  unsigned int x = (orientations & (0x01010101u * constrained[index])) ^ (0x01010101u * required[index]);
+  // exact zero byte test: the top bit of each byte of y is set iff the byte of x is zero
+  unsigned int y = ~(((x & 0x7F7F7F7Fu) + 0x7F7F7F7Fu) | x | 0x7F7F7F7Fu);
+  return ((y >> 7) & 1) | ((y >> 14) & 2) | ((y >> 21) & 4) | ((y >> 28) & 8);
 }
 
 
@@ -33,47 +89,242 @@ Tile* Board::getTile(int i, int j) const {
 void Board::setTile(int i, int j, Tile* t) {
   assert (i >= 0 && i < numRows());
   assert (j >= 0 && j < numColumns());
-  assert (t != NULL);
-  assert (board[i][j] == NULL);
-  board[i][j] = t;
+  setCell(index(i,j), t);
+}
+
+void Board::setCell(int index, Tile* t) {
+  assert (t != NULL && t != sentinel());
+  assert (board[index] == NULL);
+  if (keyed) key ^= needs_key(index) ^ zobrist(index, PLACED_SLOT);
+  board[index] = t;
+  setOccupied(index, true);
+  constrain_neighbors(index, t->getCode());
+  count_edges(index, +1);
+
+  // a new group, merged with the groups of the placed neighbors
+  parent[index] = index;
+  group_size[index] = 1;
+  components++;
+  int merges = 0;
+  for (int side = NORTH; side <= WEST; side++) {
+    int neighbor = index + offsets[side];
+    placed_neighbors[neighbor]++;
+    if (!isPlaced(board[neighbor])) continue;
+    int a = find_root(index);
+    int b = find_root(neighbor);
+    if (a == b) continue;
+    if (group_size[a] < group_size[b]) std::swap(a, b);
+    parent[b] = a;
+    group_size[a] += group_size[b];
+    merged_roots.push_back(b);
+    merges++;
+    components--;
+  }
+  merges_per_placement.push_back(merges);
+  placement_order.push_back(index);
+}
+
+void Board::block(int index) {
+  assert (board[index] == NULL);
+  if (keyed) key ^= needs_key(index) ^ zobrist(index, BLOCKED_SLOT);
+  board[index] = sentinel();
+  constrain_neighbors(index, sentinel()->getCode());
+  count_edges(index, +1);
+}
+
+void Board::unblock(int index) {
+  assert (board[index] == sentinel());
+  count_edges(index, -1);
+  board[index] = NULL;
+  release_neighbors(index);
+  if (keyed) key ^= needs_key(index) ^ zobrist(index, BLOCKED_SLOT);
 }
 
 void Board::clear() {
-    for (int i = 0; i < numRows(); ++i) {
-        for (int j = 0; j < numColumns(); ++j) {
-            if (board[i][j] != NULL)
-                board[i][j] = NULL;
-        }
+  // the padding ring is filled with the sentinel, the grid itself is empty
+  board = std::vector<Tile*>( (unsigned int)((rows+2)*stride), sentinel() );
+  required = std::vector<EdgeCode>(board.size(), 0);
+  constrained = std::vector<EdgeCode>(board.size(), 0);
+  placed_neighbors = std::vector<unsigned char>(board.size(), 0);
+  occupied = std::vector<unsigned long long>(board.size() / 64 + 1, 0);
+  open_edges = 0;
+  for (int side = NORTH; side <= WEST; side++) {
+    for (int type = PASTURE; type <= CITY; type++) {
+      open_needs[side][type] = 0;
     }
+  }
+  mismatches = 0;
+  components = 0;
+  parent = std::vector<int>(board.size(), -1);
+  group_size = std::vector<int>(board.size(), 0);
+  merged_roots.clear();
+  merges_per_placement.clear();
+  placement_order.clear();
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < columns; c++) {
+      board[index(r,c)] = NULL;
+    }
+  }
+  // the cells along the border can only have pasture facing out
+  for (int r = 0; r < rows; r++) {
+    constrained[index(r,0)] |= 3 << (2*WEST);
+    constrained[index(r,columns-1)] |= 3 << (2*EAST);
+  }
+  for (int c = 0; c < columns; c++) {
+    constrained[index(0,c)] |= 3 << (2*NORTH);
+    constrained[index(rows-1,c)] |= 3 << (2*SOUTH);
+  }
+
+  if (keyed) compute_key();
 }
 
 void Board::eraseTile(int i, int j) {
     assert (i >= 0 && i < numRows());
     assert (j >= 0 && j < numColumns());
-    assert (board[i][j] != NULL);
-    board[i][j] = NULL;
+    eraseCell(index(i,j));
+}
+
+void Board::eraseCell(int index) {
+    assert (isPlaced(board[index]));
+    // undo the merges done when this tile was placed, it has to be the last one
+    assert (placement_order.back() == index);
+    for (int m = 0; m < merges_per_placement.back(); m++) {
+        int b = merged_roots.back();
+        group_size[parent[b]] -= group_size[b];
+        parent[b] = b;
+        merged_roots.pop_back();
+        components++;
+    }
+    merges_per_placement.pop_back();
+    placement_order.pop_back();
+    parent[index] = -1;
+    components--;
+
+    count_edges(index, -1);
+    board[index] = NULL;
+    setOccupied(index, false);
+    release_neighbors(index);
+    if (keyed) key ^= needs_key(index) ^ zobrist(index, PLACED_SLOT);
+    for (int side = NORTH; side <= WEST; side++) {
+        placed_neighbors[index + offsets[side]]--;
+    }
 }
 
 void Board::make_null(int i, int j){
-    board[i][j] = NULL;
+    int cell = index(i,j);
+    if (isBlocked(cell)) {
+        unblock(cell);
+    } else if (board[cell] != NULL) {
+        eraseCell(cell);
+    }
+}
+
+
+// ==========================================================================
+// MASK HELPERS
+// each side of a cell faces exactly one neighbor, so the neighbor's
+// mask bits for that side belong to this cell alone
+void Board::constrain_neighbors(int index, EdgeCode code) {
+  for (int side = NORTH; side <= WEST; side++) {
+    int neighbor = index + offsets[side];
+    int facing = 2 * oppositeSide(side);
+    constrained[neighbor] |= 3 << facing;
+    required[neighbor] |= getEdge(code, side) << facing;
+    if (keyed && board[neighbor] == NULL) key ^= zobrist(neighbor, Need_slot(oppositeSide(side), getEdge(code, side)));
+  }
+}
+
+void Board::release_neighbors(int index) {
+  for (int side = NORTH; side <= WEST; side++) {
+    int neighbor = index + offsets[side];
+    int facing = 2 * oppositeSide(side);
+    if (keyed && board[neighbor] == NULL) {
+      key ^= zobrist(neighbor, Need_slot(oppositeSide(side), (required[neighbor] >> facing) & 3));
+    }
+    constrained[neighbor] &= ~(3 << facing);
+    required[neighbor] &= ~(3 << facing);
+  }
+}
+
+unsigned long long Board::needs_key(int index) const {
+  unsigned long long result = 0;
+  for (int side = NORTH; side <= WEST; side++) {
+    if ((constrained[index] >> (2*side)) & 3) {
+      result ^= zobrist(index, Need_slot(side, (required[index] >> (2*side)) & 3));
+    }
+  }
+  return result;
+}
+
+// Adds (sign +1) or removes (sign -1) the contribution of the tile or
+// sentinel in this cell to the open and mismatched edge counts.
+void Board::count_edges(int index, int sign) {
+  Tile *t = board[index];
+  EdgeCode code = t->getCode();
+  bool is_sentinel = (t == sentinel());
+  for (int side = NORTH; side <= WEST; side++) {
+    Tile *neighbor = board[index + offsets[side]];
+    EdgeType edge = getEdge(code, side);
+    if (neighbor == NULL) {
+      // only a tile leaves an edge open, a blocked cell has no edges of its own
+      if (!is_sentinel && edge != PASTURE) {
+        open_edges += sign;
+        open_needs[oppositeSide(side)][edge] += sign;
+      }
+      continue;
+    }
+    if (is_sentinel && neighbor == sentinel()) continue;
+    EdgeType facing = getEdge(neighbor->getCode(), oppositeSide(side));
+    // the neighbor's edge towards this cell is no longer open
+    if (neighbor != sentinel() && facing != PASTURE) {
+      open_edges -= sign;
+      open_needs[side][facing] -= sign;
+    }
+    if (edge != facing) mismatches += sign;
+  }
+}
+
+int Board::find_root(int index) const {
+  while (parent[index] != index) {
+    index = parent[index];
+  }
+  return index;
+}
+
+void Board::setOccupied(int index, bool value) {
+  if (value) {
+    occupied[index >> 6] |= 1ULL << (index & 63);
+  } else {
+    occupied[index >> 6] &= ~(1ULL << (index & 63));
+  }
 }
 
 // ==========================================================================
 // PRINTING
-void Board::Print() const {
+void Board::Print(bool compact) const {
+  int size = compact ? 1 : GLOBAL_TILE_SIZE;
+  // each line is a row of characters of every tile, then a newline
+  int line = numColumns() * size + 1;
+  int total = numRows() * size * line;
+  if (print_buffer.size() < total) print_buffer.resize(total);
+  char *out = &print_buffer[0];
   for (int b = 0; b < numRows(); b++) {
-    for (int i = 0; i < GLOBAL_TILE_SIZE; i++) {
+    for (int i = 0; i < size; i++) {
       for (int j = 0; j < numColumns(); j++) {
-        if (board[b][j] != NULL) {
-          board[b][j]->printRow(std::cout,i);
+        Tile *t = getTile(b,j);
+        if (compact) {
+          *out = (t != NULL) ? t->compactChar() : '.';
+        } else if (t != NULL) {
+          t->renderRow(out,i);
         } else {
-          std::cout << std::string(GLOBAL_TILE_SIZE,' ');
+          memset(out,' ',size);
         }
+        out += size;
       }
-      std::cout << "\n";
+      *out++ = '\n';
     }
   }
-  fflush(stdout);
+  std::cout.write(&print_buffer[0], total);
 }
 
 // ==========================================================================
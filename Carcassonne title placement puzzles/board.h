@@ -7,6 +7,31 @@
 
 // This class stores a grid of Tile pointers, which are NULL if the
 // grid location does not (yet) contain a tile
+//
+// The grid is one contiguous array with a ring of padding cells around
+// it.  The padding (and any cell a search has blocked) holds a shared
+// pasture-only sentinel tile, so the neighbor of a cell on any side is
+// a fixed offset away and needs no bounds check: a tile next to the
+// border simply has to match the sentinel's pasture edges.
+//
+// For each cell the board also keeps the edges its neighbors require
+// (a 2 bit mask per side that is constrained, and the edge values), an
+// occupancy bitset and the number of placed neighbors.  Testing whether
+// a tile fits is then one AND and one compare against its edge code, and
+// fitMask tests up to 4 orientations packed in one word at once.
+//
+// Finally it counts, as tiles come and go, the road/city edges left open
+// (facing an empty cell), the edges that do not match their neighbor,
+// and the connected groups of tiles (union-find that is rolled back on
+// erase, so tiles must be erased in the reverse order they were set).
+// A finished layout is checked from these counters in O(1).
+//
+// Once enableKeys is called, it also keeps a Zobrist key of what is left
+// for a search to do: which cells are taken by a tile or blocked, and the
+// edges each empty cell must have.  Two boards with the same key (and the
+// same tiles left) have the same completions, whatever tiles sit inside
+// the layout.  The keys cost 14 words per cell, so boards that are never
+// looked up in a transposition table go without.
 
 class Board {
 public:
@@ -16,25 +41,110 @@ public:
   Board(int i, int j);
 
   // ACCESSORS
-  int numRows() const { return board.size(); }
-  int numColumns() const { return board[0].size(); }
+  int numRows() const { return rows; }
+  int numColumns() const { return columns; }
+  // NULL if the cell is empty (or blocked)
   Tile* getTile(int i, int j) const;
 
+  // FLAT ACCESS, used by the solver's inner loops (no bounds checks)
+  int index(int i, int j) const { return (i+1)*stride + (j+1); }
+  int getRow(int index) const { return index / stride - 1; }
+  int getColumn(int index) const { return index % stride - 1; }
+  // offset from a cell to its neighbor on a side (NORTH, EAST, ...)
+  int offset(int side) const { return offsets[side]; }
+  // the raw content of a cell, may be the sentinel
+  Tile* getCell(int index) const { return board[index]; }
+  Tile* getNeighbor(int index, int side) const { return board[index + offsets[side]]; }
+  bool isBlocked(int index) const { return board[index] == sentinel(); }
+  bool isOccupied(int index) const { return (occupied[index >> 6] >> (index & 63)) & 1; }
+  // the edges that a tile in this cell must have, on the constrained sides
+  EdgeCode requiredEdges(int index) const { return required[index]; }
+  EdgeCode constrainedSides(int index) const { return constrained[index]; }
+  int numPlacedNeighbors(int index) const { return placed_neighbors[index]; }
+  bool fits(int index, EdgeCode code) const {
+    return (code & constrained[index]) == required[index];
+  }
+  // orientations holds one edge code per byte; bit k of the answer is set
+  // if the code in byte k fits the cell
+  unsigned int fitMask(int index, unsigned int orientations) const;
+  // true for a tile placed by a search (not NULL, not the sentinel)
+  static bool isPlaced(const Tile *t) { return t != NULL && t != sentinel(); }
+  static Tile* sentinel();
+
+  // LAYOUT COUNTERS
+  int numPlaced() const { return placement_order.size(); }
+  int numOpenEdges() const { return open_edges; }
+  // open edges by what they ask of the empty cell they face: the number
+  // of empty cells that need "type" on their "side"
+  int numOpenNeeds(int side, EdgeType type) const { return open_needs[side][type]; }
+  int numMismatches() const { return mismatches; }
+  int numComponents() const { return components; }
+  // only kept up to date after enableKeys
+  unsigned long long getKey() const { return key; }
+
   // MODIFIERS
   void setTile(int i, int j, Tile* t);
+  void setCell(int index, Tile* t);
+  // a blocked cell must stay empty, its neighbors see pasture
+  void block(int index);
+  void unblock(int index);
+  // starts keeping the key (see getKey), from the board as it is now
+  void enableKeys();
   
   // FOR PRINTING
-  void Print() const;
+  // The whole board is drawn into one buffer (kept between calls) and
+  // written to std::cout at once.  Compact draws one character per cell
+  // (see Tile::compactChar, '.' for an empty cell) instead of the art.
+  void Print(bool compact = false) const;
     
   void make_null(int i, int j);
   void eraseTile(int i, int j);
+  void eraseCell(int index);
   void clear();
   bool is_full_board();
     
 private:
 
+  // keeps the masks of the 4 neighbors of a cell up to date
+  void constrain_neighbors(int index, EdgeCode code);
+  void release_neighbors(int index);
+  void setOccupied(int index, bool value);
+  // counts the open and mismatched edges between a cell and its neighbors
+  void count_edges(int index, int sign);
+  int find_root(int index) const;
+  // the key of the edges required of an empty cell
+  unsigned long long needs_key(int index) const;
+  unsigned long long zobrist(int index, int slot) const { return zobrist_keys[index * 14 + slot]; }
+  // the key of the whole board, from scratch
+  void compute_key();
+
   // REPRESENTATION
-  std::vector<std::vector<Tile*> > board;
+  int rows;
+  int columns;
+  int stride;
+  int offsets[4];
+  std::vector<Tile*> board;
+  std::vector<EdgeCode> required;
+  std::vector<EdgeCode> constrained;
+  std::vector<unsigned char> placed_neighbors;
+  std::vector<unsigned long long> occupied;
+  int open_edges;
+  int open_needs[4][3];
+  int mismatches;
+  int components;
+  // union-find over the placed cells, without path compression so the
+  // merges done by each placement can be undone
+  std::vector<int> parent;
+  std::vector<int> group_size;
+  std::vector<int> merged_roots;
+  std::vector<int> merges_per_placement;
+  std::vector<int> placement_order;
+  // per cell: placed, blocked, then one per side and edge type needed,
+  // empty until enableKeys
+  bool keyed;
+  std::vector<unsigned long long> zobrist_keys;
+  unsigned long long key;
+  mutable std::vector<char> print_buffer;
 };
 
 
@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+
+
+// the first line of every checkpoint file
+static const char *HEADER = "CARCASSONNE CHECKPOINT 1";
+
+
+// ==========================================================================
+SearchCheckpoint::SearchCheckpoint(const std::vector<Tile*> &tiles, int r, int c, bool rotations,
+                                   CheckpointVisitor &v) :
+  rows(r), columns(c), allow_rotations(rotations), visitor(v), interval(0), num_entered(0),
+  last_save(std::chrono::steady_clock::now()), resume_depth(0) {
+  for (int t = 0; t < tiles.size(); t++) {
+    codes.push_back(tiles[t]->getCode());
+  }
+  cells = std::vector<int>(tiles.size(), 0);
+  orientations = std::vector<int>(tiles.size(), 0);
+}
+
+
+void SearchCheckpoint::setFile(const std::string &f, double seconds) {
+  filename = f;
+  interval = seconds;
+}
+
+
+// what the search is run on, a resumed search must be run on the same
+void SearchCheckpoint::Write_puzzle(std::ostream &ostr) const {
+  ostr << "tiles " << codes.size();
+  for (int t = 0; t < codes.size(); t++) {
+    ostr << " " << int(codes[t]);
+  }
+  ostr << "\nboard " << rows << " " << columns << "\nrotations " << allow_rotations << "\n";
+}
+
+
+// ==========================================================================
+void SearchCheckpoint::Enter(int index, const SearchStats *stats) {
+  if (resume_depth > 0) {
+    // back at the saved node, the search goes on from here as it would have
+    if (index == resume_depth) resume_depth = 0;
+    return;
+  }
+  if (filename.empty() || (++num_entered & 1023) != 0) return;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (std::chrono::duration<double>(now - last_save).count() >= interval) {
+    Save(index, stats);
+    last_save = now;
+  }
+}
+
+
+void SearchCheckpoint::Save(int index, const SearchStats *stats) {
+  // on the way back down to a resumed node the file it came from still
+  // holds the position
+  if (filename.empty() || resume_depth > 0) return;
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream ostr(tmp.c_str());
+    ostr << HEADER << "\n";
+    Write_puzzle(ostr);
+    ostr << "nodes " << (stats != NULL ? stats->nodes : 0) << "\n";
+    ostr << "path " << index;
+    for (int p = 0; p < index; p++) {
+      ostr << " " << cells[p] << " " << orientations[p];
+    }
+    ostr << "\n";
+    visitor.Save(ostr);
+    if (!ostr) {
+      std::cerr << "ERROR: cannot write checkpoint '" << tmp << "'" << std::endl;
+      return;
+    }
+  }
+  if (rename(tmp.c_str(), filename.c_str()) != 0) {
+    std::cerr << "ERROR: cannot write checkpoint '" << filename << "'" << std::endl;
+  }
+}
+
+
+// ==========================================================================
+bool SearchCheckpoint::Resume(const std::string &f, SearchStats *stats) {
+  std::ifstream istr(f.c_str());
+  if (!istr) {
+    std::cerr << "ERROR: cannot open checkpoint '" << f << "'" << std::endl;
+    return false;
+  }
+  std::string line;
+  if (!std::getline(istr, line) || line != HEADER) {
+    std::cerr << "ERROR: '" << f << "' is not a checkpoint" << std::endl;
+    return false;
+  }
+  // the puzzle lines must be the same as this one's
+  std::stringstream expected;
+  Write_puzzle(expected);
+  std::string puzzle;
+  for (int n = 0; n < 3 && std::getline(istr, line); n++) {
+    puzzle += line + "\n";
+  }
+  if (puzzle != expected.str()) {
+    std::cerr << "ERROR: checkpoint '" << f << "' is for another puzzle, board or rotation setting" << std::endl;
+    return false;
+  }
+
+  std::string word;
+  long long nodes;
+  int depth;
+  bool ok = (istr >> word >> nodes) && word == "nodes" && (istr >> word >> depth) && word == "path" &&
+    depth >= 0 && depth <= codes.size();
+  for (int p = 0; ok && p < depth; p++) {
+    ok = (istr >> cells[p] >> orientations[p]) && cells[p] >= 0 && cells[p] < rows * columns &&
+      orientations[p] >= 0 && orientations[p] < 4;
+  }
+  if (!ok || !visitor.Load(istr)) {
+    std::cerr << "ERROR: checkpoint '" << f << "' is damaged, or from another kind of search" << std::endl;
+    return false;
+  }
+  resume_depth = depth;
+  // the nodes on the path are entered again on the way back down
+  if (stats != NULL) {
+    stats->nodes = nodes - depth;
+    // a node limit is for this run, counted from where the saved one
+    // stopped, so a chain of runs each with the same limit gets to the end
+    if (stats->node_limit > 0) stats->node_limit += nodes;
+  }
+  return true;
+}
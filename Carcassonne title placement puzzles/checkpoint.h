@@ -0,0 +1,93 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "tile.h"
+#include "solver.h"
+
+
+// A visitor whose results so far can be written out and read back, so
+// a search can be saved along with them.
+class CheckpointVisitor : public SolutionVisitor {
+public:
+  virtual void Save(std::ostream &ostr) const = 0;
+  // false if the stream does not hold what Save wrote
+  virtual bool Load(std::istream &istr) = 0;
+};
+
+
+// Saving and resuming the tile ordered search (see Can_place).
+//
+// The position of the search is the path down to the node it is in: the
+// cell and orientation of the tile placed at each index.  Can_place keeps
+// the path up to date here, and every so often, on entering a node, the
+// path is written to the file along with the node count and the results
+// of the visitor.  Every solution handed out before that node is in the
+// file and none after it, so a search resumed from the file goes straight
+// back down the path and carries on exactly as the saved one would have:
+// it ends with the same results (and node count).
+//
+// A search that runs out of its budget (see SearchStats) saves where it
+// stopped.  The file is written under a temporary name and then renamed,
+// so a crash while saving leaves the last checkpoint whole.
+
+class SearchCheckpoint {
+public:
+  // rows and columns of the board searched
+  SearchCheckpoint(const std::vector<Tile*> &tiles, int rows, int columns, bool allow_rotations,
+                   CheckpointVisitor &visitor);
+
+  // save to this file, at most every "seconds" (and when out of budget)
+  void setFile(const std::string &filename, double seconds);
+
+  // Reads a checkpoint of the same puzzle, so the next search starts from
+  // it; the node count goes to stats (if any), and a node limit already
+  // set there is moved up by it, so the limit is the nodes this run may
+  // add.  False, with a message on std::cerr, if the file cannot be read
+  // or is for another puzzle.
+  bool Resume(const std::string &filename, SearchStats *stats);
+
+  // CALLED BY Can_place
+  // on entering a node, at "index" tiles placed (before stats counts it)
+  void Enter(int index, const SearchStats *stats);
+  // when the search runs out of budget in that node
+  void Out_of_budget(int index, const SearchStats *stats) { Save(index, stats); }
+  // the tile at index is being tried on cell (row * columns + column), in
+  // orientation k of its kind
+  void Step(int index, int cell, int k) { cells[index] = cell; orientations[index] = k; }
+  // while going back down to a resumed node, the step to take first at
+  // index, false once past it
+  bool Resuming(int index, int &cell, int &k) const {
+    if (index >= resume_depth) return false;
+    cell = cells[index];
+    k = orientations[index];
+    return true;
+  }
+
+private:
+
+  void Save(int index, const SearchStats *stats);
+  void Write_puzzle(std::ostream &ostr) const;
+
+  // REPRESENTATION
+  std::vector<EdgeCode> codes;
+  int rows;
+  int columns;
+  bool allow_rotations;
+  CheckpointVisitor &visitor;
+  std::string filename;
+  double interval;
+  // the clock is read every 1024 nodes
+  long long num_entered;
+  std::chrono::steady_clock::time_point last_save;
+  std::vector<int> cells;
+  std::vector<int> orientations;
+  // steps still to replay, 0 once the resumed node is reached
+  int resume_depth;
+};
+
+
+#endif
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "dlx.h"
+
+
+// ==========================================================================
+// CONSTRUCTOR
+ExactCoverSearch::ExactCoverSearch(Board &b, const TileInventory &inv) :
+  board(b), inventory(inv), locations(NULL), visitor(NULL), stats(NULL), supply(inv.getSupplyFrom(0)) {
+  cell_of = std::vector<int>(inventory.numTiles(), -1);
+  Build_items();
+  Build_options();
+}
+
+
+// ==========================================================================
+// numbers the items, primary ones first
+void ExactCoverSearch::Build_items() {
+  int rows = board.numRows();
+  int columns = board.numColumns();
+  int num_cells = rows * columns;
+  // with as many tiles as cells every cell must be covered
+  bool dense = (inventory.numTiles() == num_cells);
+
+  int next = 1;
+  tile_item = std::vector<int>(inventory.numTiles());
+  for (int t = 0; t < inventory.numTiles(); t++) {
+    tile_item[t] = next++;
+  }
+  cell_item = std::vector<int>(num_cells);
+  if (dense) {
+    for (int c = 0; c < num_cells; c++) {
+      cell_item[c] = next++;
+    }
+  }
+  num_primary = next - 1;
+  if (!dense) {
+    for (int c = 0; c < num_cells; c++) {
+      cell_item[c] = next++;
+    }
+  }
+  // the edge between a cell and its east (south) neighbor, -1 on the border
+  east_edge_item = std::vector<int>(num_cells, -1);
+  south_edge_item = std::vector<int>(num_cells, -1);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      if (j + 1 < columns) east_edge_item[i * columns + j] = next++;
+      if (i + 1 < rows) south_edge_item[i * columns + j] = next++;
+    }
+  }
+  num_items = next - 1;
+
+  // the two circular lists of items
+  llink = std::vector<int>(num_items + 2);
+  rlink = std::vector<int>(num_items + 2);
+  for (int i = 0; i <= num_primary; i++) {
+    llink[i] = (i == 0) ? num_primary : i - 1;
+    rlink[i] = (i == num_primary) ? 0 : i + 1;
+  }
+  int head = num_items + 1;
+  llink[head] = (num_items > num_primary) ? num_items : head;
+  rlink[head] = (num_items > num_primary) ? num_primary + 1 : head;
+  for (int i = num_primary + 1; i <= num_items; i++) {
+    llink[i] = (i == num_primary + 1) ? head : i - 1;
+    rlink[i] = (i == num_items) ? head : i + 1;
+  }
+
+  // empty vertical lists, then the first spacer
+  for (int i = 0; i <= num_items; i++) {
+    top.push_back(0);
+    ulink.push_back(i);
+    dlink.push_back(i);
+    color.push_back(0);
+    node_option.push_back(-1);
+  }
+  top.push_back(0);
+  ulink.push_back(0);
+  dlink.push_back(0);
+  color.push_back(0);
+  node_option.push_back(-1);
+}
+
+
+// ==========================================================================
+// one option per tile, cell and distinct orientation that keeps roads and
+// cities off the border
+void ExactCoverSearch::Build_options() {
+  int rows = board.numRows();
+  int columns = board.numColumns();
+  std::vector<int> items;
+  std::vector<int> colors;
+  for (int kind = 0; kind < inventory.numKinds(); kind++) {
+    for (int copy = 0; copy < inventory.numCopies(kind); copy++) {
+      int tile = inventory.getTileIndex(kind, copy);
+      for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < columns; j++) {
+          int cell = i * columns + j;
+          for (int k = 0; k < inventory.numOrientations(kind); k++) {
+            if (!(inventory.getAllowedOrientations(kind) & (1 << k))) continue;
+            const Tile *tmp = inventory.getOrientation(kind, k);
+            // the board is empty, so only its border constrains the cell
+            if (!Check_tile(board, tmp, board.index(i, j))) continue;
+            EdgeCode code = tmp->getCode();
+            items.clear();
+            colors.clear();
+            items.push_back(tile_item[tile]);
+            colors.push_back(0);
+            items.push_back(cell_item[cell]);
+            colors.push_back(0);
+            // edge items are colored by edge type + 1, 0 means no color
+            if (i > 0) {
+              items.push_back(south_edge_item[cell - columns]);
+              colors.push_back(getEdge(code, NORTH) + 1);
+            }
+            if (j + 1 < columns) {
+              items.push_back(east_edge_item[cell]);
+              colors.push_back(getEdge(code, EAST) + 1);
+            }
+            if (i + 1 < rows) {
+              items.push_back(south_edge_item[cell]);
+              colors.push_back(getEdge(code, SOUTH) + 1);
+            }
+            if (j > 0) {
+              items.push_back(east_edge_item[cell - 1]);
+              colors.push_back(getEdge(code, WEST) + 1);
+            }
+            Option option = { kind, copy, board.index(i, j), k };
+            Add_option(option, items, colors);
+          }
+        }
+      }
+    }
+  }
+}
+
+
+// appends the nodes of an option and the spacer after it
+void ExactCoverSearch::Add_option(const Option &option, const std::vector<int> &items,
+                                  const std::vector<int> &colors) {
+  int spacer = top.size() - 1;
+  int first = top.size();
+  for (int n = 0; n < items.size(); n++) {
+    int item = items[n];
+    int x = top.size();
+    top.push_back(item);
+    ulink.push_back(ulink[item]);
+    dlink.push_back(item);
+    color.push_back(colors[n]);
+    node_option.push_back(options.size());
+    dlink[ulink[item]] = x;
+    ulink[item] = x;
+    top[item]++;
+  }
+  dlink[spacer] = top.size() - 1;
+  top.push_back(-int(options.size()) - 1);
+  ulink.push_back(first);
+  dlink.push_back(0);
+  color.push_back(0);
+  node_option.push_back(-1);
+  options.push_back(option);
+}
+
+
+// ==========================================================================
+bool ExactCoverSearch::Search(std::vector<Location> &l, SolutionVisitor &v) {
+  locations = &l;
+  visitor = &v;
+  locations->assign(inventory.numTiles(), Location());
+  return Solve();
+}
+
+
+//---------------------------------------------------------------------
+bool ExactCoverSearch::Solve() {
+  if (stats != NULL) {
+    if (stats->Over_budget()) return true;
+    stats->nodes++;
+  }
+
+  // every tile is placed: exact cover guarantees the matched edges, the
+  // board's counters the rest
+  if (rlink[0] == 0) {
+    if (!Check_the_whole_board(board)) return false;
+    return visitor->Visit(board, *locations);
+  }
+
+  // branch on the primary item with the fewest options left
+  int best = rlink[0];
+  for (int i = rlink[best]; i != 0; i = rlink[i]) {
+    if (top[i] < top[best]) best = i;
+  }
+  if (top[best] == 0) return false;   // DEAD END
+
+  Cover(best);
+  for (int x = dlink[best]; x != best; x = dlink[x]) {
+    if (Try_option(x)) return true;   // the board is left holding the solution
+  }
+  Uncover(best);
+  return false;
+}
+
+
+// commits the other items of the option holding node x, places its tile
+// and searches on
+bool ExactCoverSearch::Try_option(int x) {
+  const Option &option = options[node_option[x]];
+  if (!Copies_in_order(option)) return false;
+
+  for (int p = x + 1; p != x; ) {
+    int j = top[p];
+    if (j <= 0) {
+      p = ulink[p];
+    } else {
+      Commit(p, j);
+      p++;
+    }
+  }
+
+  int tile = inventory.getTileIndex(option.kind, option.copy);
+  EdgeCode code = inventory.getOrientation(option.kind, 0)->getCode();
+  board.setCell(option.cell, inventory.getOrientation(option.kind, option.orientation));
+  (*locations)[tile] = Location(board.getRow(option.cell), board.getColumn(option.cell),
+                                inventory.getRotation(option.kind, option.orientation, option.copy));
+  cell_of[tile] = option.cell;
+  supply.add(code, -1);
+
+  int tiles_left = inventory.numTiles() - board.numPlaced();
+  if (Can_still_close(board, supply, inventory.allowsRotations(), tiles_left) &&
+      Can_reach_corner(Top_row(), Left_column(), tiles_left)) {
+    if (Solve()) return true;
+  }
+
+  supply.add(code, 1);
+  cell_of[tile] = -1;
+  (*locations)[tile] = Location();
+  board.eraseCell(option.cell);
+
+  for (int p = x - 1; p != x; ) {
+    int j = top[p];
+    if (j <= 0) {
+      p = dlink[p];
+    } else {
+      Uncommit(p, j);
+      p--;
+    }
+  }
+  return false;
+}
+
+
+// the top row and left column of the tiles placed so far
+int ExactCoverSearch::Top_row() const {
+  int top_row = board.numRows();
+  for (int t = 0; t < cell_of.size(); t++) {
+    if (cell_of[t] != -1) top_row = std::min(top_row, board.getRow(cell_of[t]));
+  }
+  return top_row;
+}
+
+
+int ExactCoverSearch::Left_column() const {
+  int left_column = board.numColumns();
+  for (int t = 0; t < cell_of.size(); t++) {
+    if (cell_of[t] != -1) left_column = std::min(left_column, board.getColumn(cell_of[t]));
+  }
+  return left_column;
+}
+
+
+// copies of a kind must sit on increasing cells
+bool ExactCoverSearch::Copies_in_order(const Option &option) const {
+  if (option.copy > 0) {
+    int prev = cell_of[inventory.getTileIndex(option.kind, option.copy - 1)];
+    if (prev != -1 && prev >= option.cell) return false;
+  }
+  if (option.copy + 1 < inventory.numCopies(option.kind)) {
+    int next = cell_of[inventory.getTileIndex(option.kind, option.copy + 1)];
+    if (next != -1 && next <= option.cell) return false;
+  }
+  return true;
+}
+
+
+// ==========================================================================
+// DANCING LINKS
+// removes an item and every option that uses it
+void ExactCoverSearch::Cover(int i) {
+  for (int p = dlink[i]; p != i; p = dlink[p]) {
+    Hide(p);
+  }
+  int l = llink[i];
+  int r = rlink[i];
+  rlink[l] = r;
+  llink[r] = l;
+}
+
+
+void ExactCoverSearch::Uncover(int i) {
+  int l = llink[i];
+  int r = rlink[i];
+  rlink[l] = i;
+  llink[r] = i;
+  for (int p = ulink[i]; p != i; p = ulink[p]) {
+    Unhide(p);
+  }
+}
+
+
+// takes the other nodes of the option holding node p out of their items
+void ExactCoverSearch::Hide(int p) {
+  for (int q = p + 1; q != p; ) {
+    int x = top[q];
+    if (x <= 0) {
+      q = ulink[q];
+      continue;
+    }
+    // an item whose color is already fixed is not in the way
+    if (color[q] >= 0) {
+      dlink[ulink[q]] = dlink[q];
+      ulink[dlink[q]] = ulink[q];
+      top[x]--;
+    }
+    q++;
+  }
+}
+
+
+void ExactCoverSearch::Unhide(int p) {
+  for (int q = p - 1; q != p; ) {
+    int x = top[q];
+    if (x <= 0) {
+      q = dlink[q];
+      continue;
+    }
+    if (color[q] >= 0) {
+      dlink[ulink[q]] = q;
+      ulink[dlink[q]] = q;
+      top[x]++;
+    }
+    q--;
+  }
+}
+
+
+// an uncolored item is covered, a colored one keeps only the options
+// that give it the same color
+void ExactCoverSearch::Commit(int p, int j) {
+  if (color[p] == 0) Cover(j);
+  else if (color[p] > 0) Purify(p);
+}
+
+
+void ExactCoverSearch::Uncommit(int p, int j) {
+  if (color[p] == 0) Uncover(j);
+  else if (color[p] > 0) Unpurify(p);
+}
+
+
+// The nodes that agree with p are marked -1 (nothing left to do for them
+// if their option is chosen later), the others lose their options.  p
+// keeps its color so that Uncommit knows to undo this.
+void ExactCoverSearch::Purify(int p) {
+  int c = color[p];
+  int i = top[p];
+  for (int q = dlink[i]; q != i; q = dlink[q]) {
+    if (q == p) continue;
+    if (color[q] == c) color[q] = -1;
+    else Hide(q);
+  }
+}
+
+
+void ExactCoverSearch::Unpurify(int p) {
+  int c = color[p];
+  int i = top[p];
+  for (int q = ulink[i]; q != i; q = ulink[q]) {
+    if (q == p) continue;
+    if (color[q] < 0) color[q] = c;
+    else Unhide(q);
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef __DLX_H__
+#define __DLX_H__
+
+#include <vector>
+#include "solver.h"
+
+
+// Exact cover engine: the puzzle is written as an exact cover problem
+// with colors (Knuth's Algorithm C) and solved with Dancing Links.
+//
+// Every option (row) puts one tile in one cell in one orientation, and
+// covers these items (columns):
+//  - the tile, a primary item: each tile is used exactly once;
+//  - the cell, at most one tile per cell (a primary item as well when
+//    there are as many tiles as cells, so every cell must be filled);
+//  - the edges between the cell and each of its neighbors, secondary
+//    items colored by the edge type the tile puts there, so two tiles
+//    next to each other must agree on their shared edge.
+// Options with a road or city on the border of the board are never built.
+//
+// What exact cover cannot say (no road or city may run into an empty
+// cell, the tiles form one group) is checked on a Board that follows the
+// search, from its O(1) counters, along with Can_still_close.  As in the
+// other searches, only layouts in the top left corner of the board are
+// kept, and copies of the same kind of tile are kept on increasing cells
+// so identical tiles never trade places.
+
+class ExactCoverSearch {
+public:
+  ExactCoverSearch(Board &board, const TileInventory &inventory);
+
+  // Same contract as CellSearch::Search: locations[t] is set to the
+  // location of tile t.  Returns true if the visitor asked to stop.
+  bool Search(std::vector<Location> &locations, SolutionVisitor &visitor);
+
+  // the work done is added to these, and the search stops like Can_place
+  // once they are out of budget (NULL, the default, for none)
+  void setStats(SearchStats *s) { stats = s; }
+
+private:
+
+  // one option: tile number "copy" of "kind" in "cell" (a flat Board
+  // index), in orientation k of the kind
+  struct Option {
+    int kind, copy, cell, orientation;
+  };
+
+  // HELPER FUNCTIONS
+  void Build_items();
+  void Build_options();
+  void Add_option(const Option &option, const std::vector<int> &items, const std::vector<int> &colors);
+  bool Solve();
+  bool Try_option(int x);
+  bool Copies_in_order(const Option &option) const;
+  int Top_row() const;
+  int Left_column() const;
+  // the dancing links operations of Algorithm C
+  void Cover(int i);
+  void Uncover(int i);
+  void Hide(int p);
+  void Unhide(int p);
+  void Commit(int p, int j);
+  void Uncommit(int p, int j);
+  void Purify(int p);
+  void Unpurify(int p);
+
+  // REPRESENTATION
+  Board &board;
+  const TileInventory &inventory;
+  std::vector<Location> *locations;
+  SolutionVisitor *visitor;
+  SearchStats *stats;
+  // item numbers: tiles, cells, then the edges between cells
+  int num_primary;
+  int num_items;
+  std::vector<int> tile_item;
+  std::vector<int> cell_item;
+  std::vector<int> east_edge_item;
+  std::vector<int> south_edge_item;
+  // the horizontal list of items still to cover, 0 heads the primary
+  // items and num_items + 1 the secondary ones
+  std::vector<int> llink, rlink;
+  // the nodes: item headers 0..num_items, then the options separated by
+  // spacers.  top is the item of a node (its length for a header, and
+  // <= 0 for a spacer), color is 0 for an uncolored item, -1 once the
+  // item already has the node's color
+  std::vector<int> top, ulink, dlink, color;
+  // option number of each node
+  std::vector<int> node_option;
+  std::vector<Option> options;
+  // cell of each tile placed so far, -1 if not placed, by input tile
+  std::vector<int> cell_of;
+  EdgeSupply supply;
+};
+
+
+#endif
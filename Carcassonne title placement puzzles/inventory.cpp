@@ -0,0 +1,153 @@
+#include <cassert>
+#include <vector>
+
+#include "inventory.h"
+
+
+// ==========================================================================
+EdgeSupply::EdgeSupply() {
+  for (int side = NORTH; side <= WEST; side++) {
+    for (int type = PASTURE; type <= CITY; type++) {
+      count[side][type] = 0;
+    }
+  }
+}
+
+void EdgeSupply::add(EdgeCode code, int copies) {
+  for (int side = NORTH; side <= WEST; side++) {
+    count[side][getEdge(code, side)] += copies;
+  }
+}
+
+
+// ==========================================================================
+// The tile turned clockwise by n*90 degrees.  A tile of every legal edge
+// code is made the first time (thread safe, and never deleted, like
+// Board::sentinel) and handed out read only from then on.
+static Tile* Shared_rotation(const Tile *tile, int n) {
+  static const std::vector<Tile*> table = []() {
+    std::vector<Tile*> answer(256, (Tile*)NULL);
+    for (int code = 0; code < 256; code++) {
+      if (Tile::checkCode(EdgeCode(code)) == NULL) answer[code] = new Tile(EdgeCode(code));
+    }
+    return answer;
+  }();
+  Tile *answer = table[rotateCode(tile->getCode(), n)];
+  assert (answer != NULL);
+  return answer;
+}
+
+
+// ==========================================================================
+// CONSTRUCTOR
+TileInventory::TileInventory(const std::vector<Tile*> &tiles, bool rotations) {
+  num_tiles = tiles.size();
+  allow_rotations = rotations;
+  int max_turns = allow_rotations ? 4 : 1;
+
+  for (int t = 0; t < num_tiles; t++) {
+    EdgeCode code = tiles[t]->getCode();
+
+    // look for a kind this tile belongs to
+    bool found = false;
+    for (int k = 0; k < kinds.size() && !found; k++) {
+      EdgeCode first = tiles[kinds[k].members[0]]->getCode();
+      for (int n = 0; n < max_turns; n++) {
+        if (rotateCode(first, n) == code) {
+          kinds[k].members.push_back(t);
+          kinds[k].member_turns.push_back(n);
+          found = true;
+          break;
+        }
+      }
+    }
+    if (found) continue;
+
+    // a new kind, collect its distinct orientations
+    Kind kind;
+    kind.members.push_back(t);
+    kind.member_turns.push_back(0);
+    for (int n = 0; n < max_turns; n++) {
+      bool repeated = false;
+      for (int k = 0; k < kind.orientations.size(); k++) {
+        if (kind.orientations[k]->getCode() == rotateCode(code, n)) repeated = true;
+      }
+      if (repeated) continue;
+      Tile *orientation = (n == 0) ? tiles[t] : Shared_rotation(tiles[t], n);
+      kind.orientations.push_back(orientation);
+      kind.orientation_turns.push_back(n);
+    }
+    kind.orientation_word = 0;
+    for (int k = 3; k >= 0; k--) {
+      EdgeCode tmp = kind.orientations[k < kind.orientations.size() ? k : 0]->getCode();
+      kind.orientation_word = (kind.orientation_word << 8) | tmp;
+    }
+    kind.allowed = (1u << kind.orientations.size()) - 1;
+    kinds.push_back(kind);
+  }
+
+  for (int k = 0; k < kinds.size(); k++) {
+    for (int c = 0; c < kinds[k].members.size(); c++) {
+      order.push_back(std::make_pair(k, c));
+    }
+  }
+
+  // suffix sums of the edges, in input orientation
+  supply_from = std::vector<EdgeSupply>(num_tiles + 1);
+  for (int index = num_tiles - 1; index >= 0; index--) {
+    supply_from[index] = supply_from[index + 1];
+    supply_from[index].add(getOrientation(kindAt(index), 0)->getCode(), 1);
+  }
+}
+
+
+// ==========================================================================
+// ACCESSORS
+int TileInventory::getRotation(int kind, int k, int copy) const {
+  const Kind &tmp = kinds[kind];
+  return 90 * ((tmp.orientation_turns[k] - tmp.member_turns[copy] + 4) % 4);
+}
+
+// ==========================================================================
+
+
+// ==========================================================================
+bool TileInventory::allowsCode(EdgeCode code) const {
+  for (int k = 0; k < kinds.size(); k++) {
+    for (int n = 0; n < kinds[k].orientations.size(); n++) {
+      if (kinds[k].orientations[n]->getCode() == code) return (kinds[k].allowed >> n) & 1;
+    }
+  }
+  return false;
+}
+
+
+// ==========================================================================
+bool TileInventory::breakRotationSymmetry(bool square_board) {
+  if (!allow_rotations) return false;
+
+  // turning the whole solution turns this tile with it: a quarter turn
+  // goes to the next orientation, a half turn two further
+  int best = -1;
+  for (int k = 0; k < kinds.size(); k++) {
+    if (kinds[k].members.size() != 1) continue;
+    if (best == -1 || kinds[k].orientations.size() > kinds[best].orientations.size()) best = k;
+  }
+  if (best == -1) return false;
+  int num_orientations = kinds[best].orientations.size();
+
+  if (square_board && num_orientations > 1) {
+    // every quarter turn of a solution fits the board, keep the one that
+    // has this tile as it is (1 in 4 if the tile has 4 orientations, 1 in
+    // 2 if it looks the same after a half turn)
+    kinds[best].allowed = 1;
+    return true;
+  }
+  if (num_orientations == 4) {
+    // only the half turn of a solution is sure to fit, keep the one that
+    // has this tile as it is or turned once
+    kinds[best].allowed = 3;
+    return true;
+  }
+  return false;
+}
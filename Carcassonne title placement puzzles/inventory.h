@@ -0,0 +1,89 @@
+#ifndef __INVENTORY_H__
+#define __INVENTORY_H__
+
+#include <vector>
+#include "tile.h"
+
+
+// Road and city edges, per side, of a set of tiles (e.g. the tiles a
+// search has not placed yet), indexed by [side][EdgeType].
+struct EdgeSupply {
+  int count[4][3];
+  EdgeSupply();
+  // adds (or with a negative number, removes) copies of a tile
+  void add(EdgeCode code, int copies);
+};
+
+
+// This class groups the input tiles into kinds of identical tiles, so
+// the searches draw from a count of each kind and never try permutations
+// of tiles that cannot be told apart.  When rotations are allowed, tiles
+// that are rotations of each other are the same kind, and each kind only
+// keeps its distinct orientations (a straight road has 2, a cross 1).
+// The turned tiles are made once per process, one per edge code, and
+// shared by every inventory (and so by every puzzle of a batch).
+
+class TileInventory {
+public:
+
+  // CONSTRUCTOR & DESTRUCTOR
+  TileInventory(const std::vector<Tile*> &tiles, bool allow_rotations);
+
+  // ACCESSORS
+  int numTiles() const { return num_tiles; }
+  int numKinds() const { return kinds.size(); }
+  int numCopies(int kind) const { return kinds[kind].members.size(); }
+  bool allowsRotations() const { return allow_rotations; }
+  int numOrientations(int kind) const { return kinds[kind].orientations.size(); }
+  Tile* getOrientation(int kind, int k) const { return kinds[kind].orientations[k]; }
+  // bit k is set if the searches may use orientation k of the kind
+  unsigned int getAllowedOrientations(int kind) const { return kinds[kind].allowed; }
+  // true if a tile with these edges is one of the allowed orientations
+  bool allowsCode(EdgeCode code) const;
+  // the edge codes of the orientations packed one per byte, for Board::fitMask
+  // (bytes past numOrientations repeat orientation 0)
+  unsigned int getOrientationWord(int kind) const { return kinds[kind].orientation_word; }
+
+  // which input tile is used as copy number "copy" of a kind, and its
+  // rotation (0, 90, 180 or 270) when placed in orientation k
+  int getTileIndex(int kind, int copy) const { return kinds[kind].members[copy]; }
+  int getRotation(int kind, int k, int copy) const;
+
+  // all the tiles listed kind by kind, copies of a kind next to each other
+  int kindAt(int index) const { return order[index].first; }
+  int copyAt(int index) const { return order[index].second; }
+  // edges of the tiles from "index" to the end of that order
+  const EdgeSupply& getSupplyFrom(int index) const { return supply_from[index]; }
+
+  // With rotations allowed, a solution turned around as a whole is a
+  // solution too.  This picks a kind with a single tile and keeps it in
+  // a fixed orientation (on a square board), or in one of two (on any
+  // board, if the tile looks different all four ways), so that only one
+  // of the turned solutions is searched for.  Returns false if no kind
+  // can be used, nothing changes then.
+  bool breakRotationSymmetry(bool square_board);
+
+private:
+
+  struct Kind {
+    // input tiles of this kind, and the quarter turns from the first
+    // member to each of them
+    std::vector<int> members;
+    std::vector<int> member_turns;
+    // distinct orientations, and their quarter turns from the first member
+    std::vector<Tile*> orientations;
+    std::vector<int> orientation_turns;
+    unsigned int orientation_word;
+    unsigned int allowed;
+  };
+
+  // REPRESENTATION
+  int num_tiles;
+  bool allow_rotations;
+  std::vector<Kind> kinds;
+  std::vector<std::pair<int,int> > order;
+  std::vector<EdgeSupply> supply_from;
+};
+
+
+#endif
@@ -2,19 +2,33 @@
 // Email: chaix@rpi.edu
 
 // ==========================================================================
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <map>
 #include <cstdlib>
 #include <string>
 #include <vector>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <dirent.h>
 
 #include "MersenneTwister.h"
 
 #include "tile.h"
+#include "tile_file.h"
 #include "location.h"
 #include "board.h"
+#include "solver.h"
+#include "solution_set.h"
+#include "parallel.h"
+#include "dlx.h"
+#include "checkpoint.h"
 
 
 // this global variable is set in main.cpp and is adjustable from the command line
@@ -23,6 +37,42 @@ int GLOBAL_TILE_SIZE = 11;
 
 
 
+// how the board of each solution is drawn
+enum PrintStyle { PRINT_ART, PRINT_COMPACT, PRINT_NONE };
+
+
+// what the command line asks for, see HandleCommandLineArguments
+struct Options {
+    Options() : rows(-1), columns(-1), all_solutions(false), allow_rotations(false), cell_search(false),
+                num_threads(1), split_depth(2), exact_cover(false), memo_megabytes(0), count_only(false),
+                histogram(false), print_style(PRINT_ART), print_stats(false), time_limit(0), node_limit(0),
+                checkpoint_every(60), batch(false) {}
+    // the puzzle file, or the list or directory of them with -batch
+    std::string filename;
+    // the board asked for, -1 if not given
+    int rows;
+    int columns;
+    bool all_solutions;
+    bool allow_rotations;
+    bool cell_search;
+    // threads of the cell ordered search, or of the batch (see Run_batch)
+    int num_threads;
+    int split_depth;
+    bool exact_cover;
+    int memo_megabytes;
+    bool count_only;
+    bool histogram;
+    PrintStyle print_style;
+    bool print_stats;
+    double time_limit;
+    long long node_limit;
+    std::string checkpoint_file;
+    double checkpoint_every;
+    std::string resume_file;
+    bool batch;
+};
+
+
 // ==========================================================================
 // Helper function that is called when an error in the command line
 // arguments is detected.
@@ -33,6 +83,18 @@ void usage(int argc, char *argv[]) {
     std::cerr << "  " << argv[0] << " <filename>  -board_dimensions <h> <w>  -allow_rotations" << std::endl;
     std::cerr << "  " << argv[0] << " <filename>  -all_solutions  -allow_rotations" << std::endl;
     std::cerr << "  " << argv[0] << " <filename>  -tile_size <odd # >= 11>" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -search <tiles|cells>" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -search cells  -threads <n>  [-split_depth <d>]" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -engine <backtrack|dlx>" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -search cells  -memo <megabytes>" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -count_only  [-histogram]" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -print <art|compact|none>" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -search tiles  -stats" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -time_limit <seconds>  -node_limit <n>" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -search tiles  -checkpoint <file>  [-checkpoint_every <seconds>]" << std::endl;
+    std::cerr << "  " << argv[0] << " <filename>  -search tiles  -resume <file>" << std::endl;
+    std::cerr << "  " << argv[0] << " <list file|directory>  -batch  [-board_dimensions <h> <w>]  [-threads <n>]" << std::endl;
+    std::cerr << "      (a list has a puzzle file per line, relative to the list's directory, and may add <h> <w>)" << std::endl;
     exit(1);
 }
 
@@ -65,14 +127,13 @@ void RandomlyPlaceTiles(Board &board, const std::vector<Tile*> &tiles, std::vect
 
 
 // ==========================================================================
-void HandleCommandLineArguments(int argc, char *argv[], std::string &filename,
-                                int &rows, int &columns, bool &all_solutions, bool &allow_rotations) {
+void HandleCommandLineArguments(int argc, char *argv[], Options &options) {
     
     // must at least put the filename on the command line
     if (argc < 2) {
         usage(argc,argv);
     }
-    filename = argv[1];
+    options.filename = argv[1];
     
     // parse the optional arguments
     for (int i = 2; i < argc; i++) {
@@ -88,23 +149,152 @@ void HandleCommandLineArguments(int argc, char *argv[], std::string &filename,
         }
         // if find all solutions or not
         else if (argv[i] == std::string("-all_solutions")) {
-            all_solutions = true;
+            options.all_solutions = true;
         }
         // setting board dimensions
         else if (argv[i] == std::string("-board_dimensions")) {
             i++;
             assert (i < argc);
-            rows = atoi(argv[i]);
+            options.rows = atoi(argv[i]);
+            i++;
+            assert (i < argc);
+            options.columns = atoi(argv[i]);
+            if (options.rows < 1 || options.columns < 1) {
+                usage(argc,argv);
+            }
+        }
+        // only count the distinct solutions, nothing is printed or kept
+        else if (argv[i] == std::string("-count_only")) {
+            options.count_only = true;
+        }
+        // with -count_only, also count them by the size of their bounding box
+        else if (argv[i] == std::string("-histogram")) {
+            options.histogram = true;
+        }
+        // the ASCII art of the board (default), one character per tile, or nothing
+        else if (argv[i] == std::string("-print")) {
+            i++;
+            assert (i < argc);
+            if (argv[i] == std::string("art")) {
+                options.print_style = PRINT_ART;
+            } else if (argv[i] == std::string("compact")) {
+                options.print_style = PRINT_COMPACT;
+            } else if (argv[i] == std::string("none")) {
+                options.print_style = PRINT_NONE;
+            } else {
+                std::cerr << "ERROR: unknown print style '" << argv[i] << "'" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // what the tile ordered search did at each depth, printed at the end
+        else if (argv[i] == std::string("-stats")) {
+            options.print_stats = true;
+        }
+        // give up after this long, the solutions found so far are reported
+        else if (argv[i] == std::string("-time_limit")) {
+            i++;
+            assert (i < argc);
+            options.time_limit = atof(argv[i]);
+            if (options.time_limit <= 0) {
+                std::cerr << "ERROR: bad time_limit" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // or after expanding this many search nodes (in this run, when resuming)
+        else if (argv[i] == std::string("-node_limit")) {
             i++;
             assert (i < argc);
-            columns = atoi(argv[i]);
-            if (rows < 1 || columns < 1) {
+            options.node_limit = atoll(argv[i]);
+            if (options.node_limit < 1) {
+                std::cerr << "ERROR: bad node_limit" << std::endl;
                 usage(argc,argv);
             }
         }
+        // save the search to this file as it goes (and when it runs out of time)
+        else if (argv[i] == std::string("-checkpoint")) {
+            i++;
+            assert (i < argc);
+            options.checkpoint_file = argv[i];
+        }
+        // how often it is saved, every 60 seconds by default
+        else if (argv[i] == std::string("-checkpoint_every")) {
+            i++;
+            assert (i < argc);
+            options.checkpoint_every = atof(argv[i]);
+            if (options.checkpoint_every <= 0) {
+                std::cerr << "ERROR: bad checkpoint_every" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // carry on from a saved search, only the solutions found after it are printed
+        else if (argv[i] == std::string("-resume")) {
+            i++;
+            assert (i < argc);
+            options.resume_file = argv[i];
+        }
+        // the filename lists puzzle files (or is a directory of them), see Run_batch
+        else if (argv[i] == std::string("-batch")) {
+            options.batch = true;
+        }
         // if allow rotations or not
         else if (argv[i] == std::string("-allow_rotations")) {
-            allow_rotations = true;
+            options.allow_rotations = true;
+        }
+        // place tiles one by one (default), or fill the cells next to the layout
+        else if (argv[i] == std::string("-search")) {
+            i++;
+            assert (i < argc);
+            if (argv[i] == std::string("cells")) {
+                options.cell_search = true;
+            } else if (argv[i] == std::string("tiles")) {
+                options.cell_search = false;
+            } else {
+                std::cerr << "ERROR: unknown search order '" << argv[i] << "'" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // the recursive searches above (default), or exact cover with dancing links
+        else if (argv[i] == std::string("-engine")) {
+            i++;
+            assert (i < argc);
+            if (argv[i] == std::string("dlx")) {
+                options.exact_cover = true;
+            } else if (argv[i] == std::string("backtrack")) {
+                options.exact_cover = false;
+            } else {
+                std::cerr << "ERROR: unknown engine '" << argv[i] << "'" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // size of the table of dead ends kept by the cell ordered search
+        else if (argv[i] == std::string("-memo")) {
+            i++;
+            assert (i < argc);
+            options.memo_megabytes = atoi(argv[i]);
+            if (options.memo_megabytes < 1) {
+                std::cerr << "ERROR: bad memo size" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // number of worker threads for the cell ordered search
+        else if (argv[i] == std::string("-threads")) {
+            i++;
+            assert (i < argc);
+            options.num_threads = atoi(argv[i]);
+            if (options.num_threads < 1) {
+                std::cerr << "ERROR: bad number of threads" << std::endl;
+                usage(argc,argv);
+            }
+        }
+        // number of placed tiles at which the search is cut into tasks
+        else if (argv[i] == std::string("-split_depth")) {
+            i++;
+            assert (i < argc);
+            options.split_depth = atoi(argv[i]);
+            if (options.split_depth < 1) {
+                std::cerr << "ERROR: bad split_depth" << std::endl;
+                usage(argc,argv);
+            }
         } else {
             std::cerr << "ERROR: unknown argument '" << argv[i] << "'" << std::endl;
             usage(argc,argv);
@@ -116,415 +306,463 @@ void HandleCommandLineArguments(int argc, char *argv[], std::string &filename,
 // ==========================================================================
 void ParseInputFile(int argc, char *argv[], const std::string &filename, std::vector<Tile*> &tiles) {
     
-    // open the file
-    std::ifstream istr(filename.c_str());
-    if (!istr) {
-        std::cerr << "ERROR: cannot open file '" << filename << "'" << std::endl;
+    // malformed lines are reported with their line numbers
+    if (!ReadTileFile(filename, tiles)) {
         usage(argc,argv);
     }
-    assert (istr);
-    
-    // read each line of the file
-    std::string token, north, east, south, west;
-    while (istr >> token >> north >> east >> south >> west) {
-        assert (token == "tile");
-        Tile *t = new Tile(north,east,south,west);
-        tiles.push_back(t);
+}
+
+// ==========================================================================
+// Runs the engine and search order picked on the command line.
+bool Run_search(Board &board, const TileInventory &inventory, std::vector<Location> &locations,
+                const Options &options, SolutionVisitor &visitor, SearchStats *stats, SearchCheckpoint *checkpoint) {
+    if (options.exact_cover) {
+        ExactCoverSearch search(board, inventory);
+        search.setStats(stats);
+        return search.Search(locations, visitor);
+    }
+    if (options.num_threads > 1) {
+        assert (options.cell_search);
+        ParallelSearch search(board.numRows(), board.numColumns(), inventory, options.num_threads, options.split_depth);
+        search.setMemoSize(options.memo_megabytes);
+        search.setStats(stats);
+        return search.Search(visitor);
     }
+    if (options.cell_search) {
+        CellSearch search(board, inventory);
+        TranspositionTable memo(options.memo_megabytes);
+        if (options.memo_megabytes > 0) search.setMemo(&memo);
+        search.setStats(stats);
+        return search.Search(locations, visitor);
+    }
+    locations.assign(inventory.numTiles(), Location());
+    return Can_place(board, inventory, locations, 0, visitor, stats, checkpoint);
 }
 
-//---------------------------------------------------------------------------------------
-// This function is used for checking the whole layout of the board after all the tiles have been used up.
-bool Check_the_whole_board(const Board &board, int& temp_Solutions, int num_Solutions) {
-    for (int i = 0; i < board.numRows(); ++i) {
-        for (int j = 0; j < board.numColumns(); ++j) {
-            if (board.getTile(i, j) != NULL) {
-                std::string north = board.getTile(i, j)->getNorth();
-                std::string south = board.getTile(i, j)->getSouth();
-                std::string east = board.getTile(i, j)->getEast();
-                std::string west = board.getTile(i, j)->getWest();
-                //-------------------------------------------------------------------------
-                if (i == 0 && j == 0) {
-                    if(west != "pasture" || north != "pasture") return false;
-                    if (board.getTile(i, j + 1) != NULL) {
-                        if (east != board.getTile(i, j + 1)->getWest()) return false;
-                    } else {
-                        if (east == "road" || east == "city") return false;
-                    }
-                    if (board.getTile(i + 1, j) != NULL) {
-                        if (south != board.getTile(i + 1, j)->getNorth()) return false;
-                    } else {
-                        if (south == "road" || south == "road") return false;
-                    }
-                }
-                //-------------------------------------------------------------------------
-                if (i == 0 && j > 0) {
-                    if (north == "road" || north == "city" ) return false;
-                    if (j < board.numColumns() - 1) {
-                        if (board.getTile(0, j + 1) == NULL && east != "pasture") return false;
-                    }
-                    if (board.getTile(i, j - 1) != NULL) {
-                        if (west != board.getTile(i, j - 1)->getEast()) return false;
-                    } else {
-                        if (west == "road" || west == "city") return false;
-                    }
-                    if (board.getTile(i + 1, j) != NULL) {
-                        if (south != board.getTile(i + 1, j)->getNorth()) return false;
-                    } else {
-                        if (south == "road" || south == "city") return false;
-                    }
-                }
-                //---------------------------------------------------------------------------
-                if (j == 0 && i > 0) {
-                    if (west == "road" || west == "city") return false;
-                    if (i < board.numRows() - 1) {
-                        if (board.getTile(i + 1, 0) == NULL && south != "pasture") return false;
-                    }
-                    if (board.getTile(i - 1, j) != NULL) {
-                        if (north != board.getTile(i - 1, j)->getSouth()) return false;
-                    } else {
-                        if (north == "road" || north == "city") return false;
-                    }
-                    if (board.getTile(i, j + 1) != NULL) {
-                        if (east != board.getTile(i, j + 1)->getWest()) return false;
-                    } else {
-                        if (east == "road" || east == "city") return false;
-                    }
-                }
-                //----------------------------------------------------------------------------
-                if (i > 0 && j > 0) {
-                    if (j < board.numColumns() - 1) {
-                        if (board.getTile(i, j + 1) == NULL && east != "pasture") return false;
-                    }
-                    
-                    if (i < board.numRows() - 1) {
-                        if (board.getTile(i + 1, j) == NULL && south != "pasture") return false;
-                    }
-                    
-                    if (board.getTile(i - 1, j) != NULL) {
-                        if (north != board.getTile(i - 1, j)->getSouth()) return false;
-                    } else {
-                        if (north == "road" || north == "city") return false;
-                    }
-                    
-                    if (board.getTile(i, j - 1) != NULL) {
-                        if (west != board.getTile(i, j - 1)->getEast()) return false;
-                    } else {
-                        if (west == "road" || west == "city") return false;
-                    }
-                }
-                //---------------------------------------------------------------------------
-                // check some special cases: （ diagonal cases )
-                //----------------------------------------------------------------------------
-                if (i > 0 && j < board.numColumns() - 1) {
-                    if (board.getTile(i - 1, j) == NULL && board.getTile(i, j + 1) == NULL &&
-                        board.getTile(i - 1, j + 1) != NULL)  return false;
-                }
-                
-                if (i < board.numRows() - 1 && j < board.numColumns() - 1) {
-                    if (board.getTile(i, j + 1 ) == NULL && board.getTile(i + 1, j) == NULL &&
-                        board.getTile(i + 1, j + 1) != NULL) return false;
-                }
-                //----------------------------------------------------------------------------
-            }
-        }
+
+// ==========================================================================
+void Print_solution(const Board &board, const std::vector<Location> &locations, PrintStyle style) {
+    std:: cout << "Solution: ";
+    for (int i = 0; i < locations.size(); ++i) {
+        std::cout << locations[i];
     }
-    ++ temp_Solutions;
+    std::cout << "\n";
+    if (style != PRINT_NONE) board.Print(style == PRINT_COMPACT);
+}
+
+
+// ==========================================================================
+// Sets up saving and resuming the search, if asked for.  Returns the
+// checkpoint to hand to the search, or NULL.
+SearchCheckpoint* Setup_checkpoint(SearchCheckpoint &checkpoint, const Options &options, SearchStats &stats) {
+    if (options.checkpoint_file.empty() && options.resume_file.empty()) return NULL;
+    if (!options.resume_file.empty() && !checkpoint.Resume(options.resume_file, &stats)) {
+        exit(1);
+    }
+    if (!options.checkpoint_file.empty()) checkpoint.setFile(options.checkpoint_file, options.checkpoint_every);
+    return &checkpoint;
+}
+
+
+// ==========================================================================
+// Prints the first valid layout and stops.
+class FirstSolutionVisitor : public CheckpointVisitor {
+public:
+    FirstSolutionVisitor(PrintStyle s) : style(s) {}
     
-    if (temp_Solutions > num_Solutions) {
+    bool Visit(const Board &board, const std::vector<Location> &locations) {
+        Print_solution(board, locations, style);
         return true;
-    } else {
-        return false;
     }
-}
-//---------------------------------------------------------------------
-// This function is used for checking the requirements of the current tile
-bool Check_tile(const Board &board, Tile* tmp, int i, int j) {
     
-    std::string north = tmp->getNorth();
-    std::string south = tmp->getSouth();
-    std::string east = tmp->getEast();
-    std::string west = tmp->getWest();
+    // nothing is found before the search stops
+    void Save(std::ostream &ostr) const { ostr << "first\n"; }
+    bool Load(std::istream &istr) {
+        std::string word;
+        return (istr >> word) && word == "first";
+    }
+    
+private:
+    PrintStyle style;
+};
+
+
+// ==========================================================================
+// Prints every distinct layout as it is streamed out of Can_place.
+class AllSolutionsVisitor : public CheckpointVisitor {
+public:
+    AllSolutionsVisitor(const std::vector<Tile*> &tiles, bool allow_rotations, PrintStyle s) :
+        Results(tiles, allow_rotations), num_found(0), style(s) {}
     
-    // First check whether the edges meet conditions:
-    if (i == 0) {
-        if (north == "road" || north == "city") return false;
+    bool Visit(const Board &board, const std::vector<Location> &locations) {
+        ++ num_found;
+        // only the first layout of each canonical form is printed
+        if (Results.insert(locations)) {
+            Print_solution(board, locations, style);
+        }
+        return false; // keep going
     }
-    if (j == 0) {
-        if (west == "road" || west == "city") return false;
+    
+    int numFound() const { return num_found; }
+    int numDistinct() const { return Results.size(); }
+    
+    void Save(std::ostream &ostr) const {
+        ostr << "all " << num_found << "\n";
+        Results.Save(ostr);
     }
-    if (i == board.numRows() - 1) {
-        if (south == "road" || south == "city") return false;
+    bool Load(std::istream &istr) {
+        std::string word;
+        return (istr >> word >> num_found) && word == "all" && Results.Load(istr);
     }
-    if (j == board.numColumns() - 1) {
-        if (east == "road" || east == "city") return false;
+    
+private:
+    // Holding all the possible different solutions:
+    SolutionSet Results;
+    int num_found;
+    PrintStyle style;
+};
+
+
+// ==========================================================================
+// Counts the distinct layouts in constant memory, nothing is printed.
+class CountingVisitor : public CheckpointVisitor {
+public:
+    CountingVisitor(const std::vector<Tile*> &tiles, const TileInventory &inventory, int rows, int columns) :
+        Results(tiles, inventory, rows, columns) {}
+    
+    bool Visit(const Board &board, const std::vector<Location> &locations) {
+        Results.insert(locations);
+        return false; // keep going
     }
     
-    // then check other tiles:
-    //----------------------------------------------------------------------------
-    if (j == 0 && i > 0) {
-        if (board.getTile(i - 1, 0) != NULL) {
-            if (north != board.getTile(i - 1, 0)->getSouth()) return false;
-        }
-        if (i < board.numRows() - 1) {
-            if (board.getTile(i + 1, 0) != NULL) {
-                if (south != board.getTile(i + 1, 0)->getNorth()) return false;
-            }
+    long long numDistinct() const { return Results.size(); }
+    const std::map<std::pair<int,int>, long long>& getHistogram() const { return Results.getHistogram(); }
+    
+    void Save(std::ostream &ostr) const { Results.Save(ostr); }
+    bool Load(std::istream &istr) { return Results.Load(istr); }
+    
+private:
+    SolutionCounter Results;
+};
+
+
+// ==========================================================================
+// BATCH MODE
+//
+// Many puzzle files are solved in one process by a pool of threads, one
+// puzzle per thread at a time, each on a board and inventory of its own.
+// The turned tiles (the table of one tile per edge code, see
+// TileInventory) are made once and shared by all of them.  Every puzzle
+// writes one line of JSON to std::cout as it finishes, e.g.
+//
+//   {"puzzle":0,"file":"puzzle1.txt","tiles":4,"rows":2,"columns":2,
+//    "solutions":1,"complete":true,"nodes":9,"seconds":2.1e-05,
+//    "solution":"(0,0,0)(0,1,0)(1,0,0)(1,1,0)"}
+//
+// (on one line), in the order they finish; "puzzle" is the place of the
+// file in the batch.  A file that cannot be solved gets an "error" in
+// place of the results.
+
+struct BatchPuzzle {
+    std::string filename;
+    int rows;
+    int columns;
+};
+
+
+// Reads the puzzles of a batch.  A directory gives all the files in it
+// (but the hidden ones), by name.  Anything else is a list, one puzzle
+// file per line, optionally followed by the board dimensions for it:
+//
+//   <filename> [<h> <w>]
+//
+// A relative filename is found from the directory of the list, as the
+// files of a directory are.  Blank lines and lines starting with '#' are
+// skipped.  The puzzles with no dimensions of their own get rows by
+// columns.
+bool Read_batch(const std::string &filename, int rows, int columns, std::vector<BatchPuzzle> &puzzles) {
+    DIR *dir = opendir(filename.c_str());
+    if (dir != NULL) {
+        std::vector<std::string> names;
+        for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') names.push_back(entry->d_name);
         }
-        if (board.getTile(i, j + 1) != NULL) {
-            if (east != board.getTile(i, j + 1)->getWest()) return false;
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        for (int i = 0; i < names.size(); i++) {
+            BatchPuzzle puzzle = { filename + "/" + names[i], rows, columns };
+            puzzles.push_back(puzzle);
         }
-    }
-    //----------------------------------------------------------------------------
-    if (i == 0 && j > 0) {
-        if (board.getTile(0, j - 1) != NULL) {
-            if (west != board.getTile(0, j - 1)->getEast()) return false;
+    } else {
+        std::ifstream istr(filename.c_str());
+        if (!istr) {
+            std::cerr << "ERROR: cannot open batch '" << filename << "'" << std::endl;
+            return false;
         }
-        if (j < board.numColumns() - 1) {
-            if (board.getTile(0, j + 1) != NULL) {
-                if (east != board.getTile(0, j + 1)->getWest()) return false;
+        // the directory of the list, with its '/' (empty for the current one)
+        std::string::size_type slash = filename.rfind('/');
+        std::string directory = (slash == std::string::npos) ? "" : filename.substr(0, slash + 1);
+        std::string line;
+        for (int line_number = 1; std::getline(istr, line); line_number++) {
+            std::stringstream words(line);
+            BatchPuzzle puzzle = { "", rows, columns };
+            if (!(words >> puzzle.filename) || puzzle.filename[0] == '#') continue;
+            std::string extra;
+            if (words >> puzzle.rows) {
+                if (!(words >> puzzle.columns) || puzzle.rows < 1 || puzzle.columns < 1 || (words >> extra)) {
+                    std::cerr << "ERROR: " << filename << ":" << line_number
+                              << ": expected <filename> [<h> <w>]" << std::endl;
+                    return false;
+                }
+            } else if (!words.eof()) {
+                std::cerr << "ERROR: " << filename << ":" << line_number
+                          << ": expected <filename> [<h> <w>]" << std::endl;
+                return false;
             }
-        }
-        if (board.getTile(i + 1, j) != NULL) {
-            if (south != board.getTile(i + 1, j)->getNorth()) return false;
+            if (puzzle.filename[0] != '/') puzzle.filename = directory + puzzle.filename;
+            puzzles.push_back(puzzle);
         }
     }
-    //----------------------------------------------------------------------------
-    if (i > 0 && j > 0) {
-        if (board.getTile(i - 1, j) != NULL) {
-            if (north != board.getTile(i - 1, j)->getSouth()) return false;
-        }
-        
-        if (board.getTile(i, j - 1) != NULL) {
-            if (west != board.getTile(i, j - 1)->getEast()) return false;
-        }
-        
-        if (i < board.numRows() - 1) {
-            if (board.getTile(i + 1, j) != NULL) {
-                if (south != board.getTile(i + 1, j)->getNorth()) return false;
-            }
-        }
-        
-        if (j < board.numColumns() - 1) {
-            if (board.getTile(i, j + 1) != NULL) {
-                if (east != board.getTile(i, j + 1)->getWest()) return false;
-            }
-        }
+    if (puzzles.empty()) {
+        std::cerr << "ERROR: no puzzles in '" << filename << "'" << std::endl;
+        return false;
     }
-    //----------------------------------------------------------------------------
     return true;
 }
 
 
+// the text between quotes in a JSON string
+std::string Json_escape(const std::string &text) {
+    std::string escaped;
+    for (int i = 0; i < text.size(); i++) {
+        if (text[i] == '"' || text[i] == '\\') escaped += '\\';
+        if ((unsigned char)text[i] < 0x20) continue;
+        escaped += text[i];
+    }
+    return escaped;
+}
+
+
 // ==========================================================================
-bool Can_place(Board &board, const std::vector<Tile*> &tiles, std::vector<Location> &locations, int index, bool allow_rotations, int& temp_Solutions, int num_Solutions) {
+// Solves one puzzle of a batch on the calling thread, and makes its line.
+// Returns false if it got an error instead.
+bool Solve_batch_puzzle(const BatchPuzzle &puzzle, int index, const Options &options, std::string &line) {
+    std::stringstream ostr;
+    ostr << "{\"puzzle\":" << index << ",\"file\":\"" << Json_escape(puzzle.filename) << "\"";
     
-    // If all the tiles have been used up:
-    if (index == tiles.size()) {
-        // check if solution.
-        if (Check_the_whole_board(board, temp_Solutions, num_Solutions)) {
-            return true;
-        } else {
-            return false;
-        }
+    std::vector<Tile*> tiles;
+    if (!ReadTileFile(puzzle.filename, tiles)) {
+        ostr << ",\"error\":\"cannot read the tiles\"}";
+        line = ostr.str();
+        return false;
+    }
+    int num_tiles = tiles.size();
+    int rows = (puzzle.rows < 1) ? num_tiles : puzzle.rows;
+    int columns = (puzzle.columns < 1) ? num_tiles : puzzle.columns;
+    ostr << ",\"tiles\":" << num_tiles;
+    bool solved = (num_tiles > 0 && rows * columns >= num_tiles);
+    if (!solved) {
+        ostr << ",\"rows\":" << rows << ",\"columns\":" << columns
+             << ",\"error\":\"" << (num_tiles == 0 ? "no tiles" : "board is not large enough") << "\"}";
     } else {
-        // If not allow rotation, keep m equal to 1, which will make one following loop
-        // only run one time.
-        int m;
-        if ( ! allow_rotations ) {
-            m = 1;
-        } else {
-            m = 4;
-        }
+        TileInventory inventory(tiles, options.allow_rotations);
+        Prepare_search(inventory, rows, columns);
+        // the board searched, after the cut
+        ostr << ",\"rows\":" << rows << ",\"columns\":" << columns;
         
-        for (int i = 0; i < board.numRows(); ++i) {
-            for (int j = 0; j < board.numColumns(); ++j) {
-                for (int n = 0; n < m; ++n) {
-                    if (board.getTile(i, j) == NULL) {
-                        Tile* tmp;
-                        // Allow roatations: simply changing the tile's features
-                        //-----------------------------------------------------
-                        if (n == 0)  {
-                            tmp = tiles[index];
-                        } else if (n == 1) {
-                            tmp = new Tile(tiles[index]->getWest(), tiles[index]->getNorth(), tiles[index]->getEast(),  tiles[index]->getSouth());
-                        } else if (n == 2) {
-                            tmp = new Tile(tiles[index]->getSouth(), tiles[index]->getWest(), tiles[index]->getNorth(), tiles[index]->getEast());
-                        } else if (n == 3) {
-                            tmp = new Tile(tiles[index]->getEast(), tiles[index]->getSouth(), tiles[index]->getWest(), tiles[index]->getNorth());
-                        }
-                        
-                        // Check whether the current tile meets the requirements
-                        //------------------------------------------------------
-                        if (Check_tile(board, tmp, i, j)) {
-                            
-                            board.setTile(i, j, tmp);
-                            locations.push_back(Location(i, j, 90 * n));
-                            //-----------------------------------------------
-                            ++ index; // Use next tile in the tiles.
-                            //-----------------------------------------------
-                            if (Can_place(board, tiles, locations, index, allow_rotations, temp_Solutions, num_Solutions)) {
-                                return true;
-                            } else {
-                                board.eraseTile(i, j);
-                                locations.pop_back();
-                                -- index;
-                            }
-                        }
-                    }
-                }
+        Board board(rows, columns);
+        std::vector<Location> locations;
+        // as for a single puzzle
+        SolutionMode mode = options.count_only ? COUNT_SOLUTIONS :
+            ((options.all_solutions || options.allow_rotations) ? ALL_SOLUTIONS : FIRST_SOLUTION);
+        SolutionTally visitor(mode, tiles, inventory, rows, columns);
+        SearchStats stats;
+        stats.time_limit = options.time_limit;
+        stats.node_limit = options.node_limit;
+        Run_search(board, inventory, locations, options, visitor, &stats, NULL);
+        double seconds = stats.Seconds();
+        
+        ostr << ",\"solutions\":" << visitor.numSolutions()
+             << ",\"complete\":" << (stats.out_of_budget ? "false" : "true")
+             << ",\"nodes\":" << stats.nodes
+             << ",\"seconds\":" << seconds
+             << ",\"solution\":";
+        if (visitor.firstSolution().empty()) {
+            ostr << "null";
+        } else {
+            ostr << "\"";
+            for (int i = 0; i < visitor.firstSolution().size(); ++i) {
+                ostr << visitor.firstSolution()[i];
             }
+            ostr << "\"";
         }
-        //-----------------------------------------------------
-        return false;   // NO SOLUTIONS!
-        //-----------------------------------------------------
+        ostr << "}";
+    }
+    
+    for (int t = 0; t < tiles.size(); t++) {
+        delete tiles[t];
     }
+    line = ostr.str();
+    return solved;
 }
 
 
+// Solves the puzzles on options.num_threads threads, each takes the next
+// puzzle not yet started until there are none left, and searches it on
+// its own (the limits are for each puzzle).  A summary goes to
+// std::cerr at the end.  Returns false if any puzzle had an error.
+bool Run_batch(const std::vector<BatchPuzzle> &puzzles, const Options &options) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<int> next(0);
+    std::atomic<int> num_errors(0);
+    std::mutex output;
+    Options search = options;
+    search.num_threads = 1;
+    
+    auto worker = [&]() {
+        for (int p = next++; p < puzzles.size(); p = next++) {
+            std::string line;
+            if (!Solve_batch_puzzle(puzzles[p], p, search, line)) ++ num_errors;
+            std::lock_guard<std::mutex> lock(output);
+            std::cout << line << std::endl;
+        }
+    };
+    int num_threads = std::min(options.num_threads, int(puzzles.size()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Solved " << puzzles.size() - num_errors << " of " << puzzles.size() << " puzzle(s) on "
+              << num_threads << " thread(s) in " << seconds << " seconds." << std::endl;
+    return num_errors == 0;
+}
 
 
 // ==========================================================================
 int main(int argc, char *argv[]) {
     
-    std::string filename;
-    int rows = -1;
-    int columns = -1;
-    bool all_solutions = false;
-    bool allow_rotations = false;
-    HandleCommandLineArguments(argc, argv, filename, rows, columns, all_solutions, allow_rotations);
+    Options options;
+    HandleCommandLineArguments(argc, argv, options);
+    if (options.batch) {
+        if (options.histogram || options.print_stats || !options.checkpoint_file.empty() || !options.resume_file.empty()) {
+            std::cerr << "ERROR: -histogram, -stats, -checkpoint and -resume cannot be used with -batch" << std::endl;
+            usage(argc,argv);
+        }
+        if (options.memo_megabytes > 0 && (!options.cell_search || options.exact_cover)) {
+            std::cerr << "ERROR: -memo needs -search cells" << std::endl;
+            usage(argc,argv);
+        }
+        std::vector<BatchPuzzle> puzzles;
+        if (!Read_batch(options.filename, options.rows, options.columns, puzzles)) {
+            usage(argc,argv);
+        }
+        return Run_batch(puzzles, options) ? 0 : 1;
+    }
+    if (options.num_threads > 1 && (!options.cell_search || options.exact_cover)) {
+        std::cerr << "ERROR: -threads needs -search cells" << std::endl;
+        usage(argc,argv);
+    }
+    if (options.histogram && !options.count_only) {
+        std::cerr << "ERROR: -histogram needs -count_only" << std::endl;
+        usage(argc,argv);
+    }
+    if (options.memo_megabytes > 0 && (!options.cell_search || options.exact_cover)) {
+        std::cerr << "ERROR: -memo needs -search cells" << std::endl;
+        usage(argc,argv);
+    }
+    if (options.print_stats && (options.cell_search || options.exact_cover)) {
+        std::cerr << "ERROR: -stats needs -search tiles" << std::endl;
+        usage(argc,argv);
+    }
+    if ((!options.checkpoint_file.empty() || !options.resume_file.empty()) && (options.cell_search || options.exact_cover)) {
+        std::cerr << "ERROR: -checkpoint and -resume need -search tiles" << std::endl;
+        usage(argc,argv);
+    }
     
     // load in the tiles
     std::vector<Tile*> tiles;
-    ParseInputFile(argc,argv,filename,tiles);
+    ParseInputFile(argc,argv,options.filename,tiles);
+    // identical tiles (and rotations, if allowed) are grouped into kinds
+    TileInventory inventory(tiles, options.allow_rotations);
     
     // confirm the specified board is large enough
-    if (rows < 1  ||  columns < 1  ||  rows * columns < tiles.size()) {
-        std::cerr << "ERROR: specified board is not large enough" << rows << "X" << columns << "=" << rows*columns << " " << tiles.size() << std::endl;
+    if (options.rows < 1  ||  options.columns < 1  ||  options.rows * options.columns < tiles.size()) {
+        std::cerr << "ERROR: specified board is not large enough" << options.rows << "X" << options.columns << "=" << options.rows*options.columns << " " << tiles.size() << std::endl;
         usage(argc,argv);
     }
     
     //----------------------------------------------------
-    // If the board is very big (rows + colums > tiles.size() ),
-    // we don't need to consider all the board places.
-    // We can just use part of it.
-    if (rows + columns > tiles.size()) {
-        rows = int(tiles.size()/2);
-        columns = int(tiles.size()/2);
-    }
+    // the board is cut down to what the layouts can reach, and one turn
+    // of each layout is searched for
+    int rows = options.rows;
+    int columns = options.columns;
+    Prepare_search(inventory, rows, columns);
 
     Board board(rows,columns);
-    //-----------------------------------------------------
-    // Holding all the possible different solutions:
-    std::vector< std::vector<Location> > Results;
-    //-----------------------------------------------------
-    
     std::vector<Location> locations;
-    int temp_Solutions = 0;
-    int num_Solutions = 0;
-    int total_Solutions = 0;
+    SearchStats stats(options.print_stats);
+    stats.time_limit = options.time_limit;
+    stats.node_limit = options.node_limit;
+    bool limited = (options.time_limit > 0 || options.node_limit > 0);
+    // the node count is saved with a checkpoint
+    bool checkpointing = (!options.checkpoint_file.empty() || !options.resume_file.empty());
+    SearchStats *search_stats = (options.print_stats || limited || checkpointing) ? &stats : NULL;
     
+    // Only the number of solutions:
+    if (options.count_only) {
+        CountingVisitor counter(tiles, inventory, rows, columns);
+        SearchCheckpoint checkpoint(tiles, rows, columns, options.allow_rotations, counter);
+        SearchCheckpoint *saves = Setup_checkpoint(checkpoint, options, stats);
+        Run_search(board, inventory, locations, options, counter, search_stats, saves);
+        if (counter.numDistinct() == 0)  std::cout << (stats.out_of_budget ? "No Solution found so far.\n" : "No Solution.\n");
+        else std::cout << "Found " << counter.numDistinct() << " Solution(s)" << (stats.out_of_budget ? " so far.\n" : ".\n");
+        if (options.histogram) {
+            const std::map<std::pair<int,int>, long long> &sizes = counter.getHistogram();
+            for (std::map<std::pair<int,int>, long long>::const_iterator itr = sizes.begin(); itr != sizes.end(); ++itr) {
+                std::cout << "  " << itr->first.first << "x" << itr->first.second << ": " << itr->second << "\n";
+            }
+        }
+    }
     // If not allow all solutions or all_rotation, just find one solution:
     // Base case:
-    if (!all_solutions && !allow_rotations) {
-        if (Can_place(board, tiles, locations, 0, allow_rotations, temp_Solutions, num_Solutions)) {
-            std:: cout << "Solution: ";
-            for (int i = 0; i < locations.size(); ++i) {
-                std::cout << locations[i];
-            }
-            std::cout << std::endl;
-            board.Print();
-        } else {
+    else if (!options.all_solutions && !options.allow_rotations) {
+        FirstSolutionVisitor first(options.print_style);
+        SearchCheckpoint checkpoint(tiles, rows, columns, options.allow_rotations, first);
+        SearchCheckpoint *saves = Setup_checkpoint(checkpoint, options, stats);
+        if (!Run_search(board, inventory, locations, options, first, search_stats, saves) &&
+            !stats.out_of_budget) {
            std::cout << "No Solution.\n";
         }
     } else { // If allow all solutions or all_rotations
-        
-        bool Break_out = false;
-        while (!Break_out) {
-            if (Can_place(board, tiles, locations, 0, allow_rotations, temp_Solutions, num_Solutions)) {
-                int count = 0;
-                if (total_Solutions != 0) {
-                    for (int m = 0; m < total_Solutions; m++) {
-                        count = 0;
-                        assert(total_Solutions == Results.size());
-                        // Corner case: If the every locations can be found,
-                        // We can initially conclude that this solution have been appeared in the past
-                        //---------------------------------------------
-                        for (int i = 0; i < tiles.size(); ++i) {
-                            for (int j = 0; j < tiles.size(); ++j) {
-                                if (Results[m][i] == locations[j]) {
-                                    count ++;
-                                }
-                            }
-                        }
-                        if (count == tiles.size()) break;
-                        //---------------------------------------------
-                        // Record the " location difference "
-                        int D_rows = 0;
-                        int D_col = 0;
-                        int D_t = 0;
-                        count = 0;
-                        for (int n = 0; n < tiles.size(); n++) {
-                            if (n == 0) {
-                                D_col = locations[n].column - Results[m][n].column;
-                                D_rows = locations[n].row - Results[m][n].row;
-                                D_t = locations[n].rotation - Results[m][n].rotation;
-                            }
-                            
-                            if ((D_col == locations[n].column - Results[m][n].column) &&
-                                (D_rows == locations[n].row - Results[m][n].row) &&
-                                (D_t == locations[n].rotation - Results[m][n].rotation)) {
-                                count++;
-                            } else {
-                                for (int i = 0; i < tiles.size(); i++) {
-                                    
-                                    if ((n != i) && (tiles[i]->getNorth() == tiles[n]->getNorth()) &&
-                                        (tiles[i]->getSouth() == tiles[n]->getSouth()) &&
-                                        (tiles[i]->getEast() == tiles[n]->getEast()) &&
-                                        (tiles[i]->getWest() == tiles[n]->getWest())) {
-                                        
-                                        if ((D_col == locations[i].column - Results[m][n].column) &&
-                                            (D_rows == locations[i].row - Results[m][n].row) &&
-                                            (D_t == locations[i].rotation - Results[m][n].rotation)) {
-                                            count++;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        // If all the tiles are the same, break out this loop,
-                        // since we find the same solution as before and we don't
-                        // need to find another one:
-                        if (count == tiles.size()) break;
-                    }
-                }
-
-                if (count != tiles.size()) {
-                    std:: cout << "Solution: ";
-                    for (int i = 0; i < locations.size(); ++i) {
-                        std::cout <<locations[i];
-                    }
-                    std::cout << std::endl;
-                    board.Print();
-                    total_Solutions ++;
-                    //--------------------------------
-                    Results.push_back(locations);
-                    //--------------------------------
-                }
-                //--------------------------------
-                // If there are no different solution,
-                // we must set all the variables to the orignal status:
-                board.clear();
-                locations.clear();
-                temp_Solutions = 0;
-                ++ num_Solutions;
-                
-            } else {
-                Break_out = true;
-            }
-        } 
-        if (num_Solutions == 0)  std::cout << "No Solution.\n";
-        else std::cout << "Found " << total_Solutions << " Solution(s).\n" ;
+        // One pass over the search tree, each layout is reported as it is found
+        AllSolutionsVisitor all(tiles, options.allow_rotations, options.print_style);
+        SearchCheckpoint checkpoint(tiles, rows, columns, options.allow_rotations, all);
+        SearchCheckpoint *saves = Setup_checkpoint(checkpoint, options, stats);
+        Run_search(board, inventory, locations, options, all, search_stats, saves);
+        if (all.numFound() == 0)  std::cout << (stats.out_of_budget ? "No Solution found so far.\n" : "No Solution.\n");
+        else std::cout << "Found " << all.numDistinct() << " Solution(s)" << (stats.out_of_budget ? " so far.\n" : ".\n");
+    }
+    // With a limit, whether the search got to the end.  A search that ran
+    // out stops like one whose visitor asked it to, so the solutions above
+    // are all good, there may just be more.
+    if (limited) {
+        if (stats.out_of_budget) {
+            bool time_out = (options.time_limit > 0 && stats.Seconds() >= options.time_limit);
+            std::cout << "Search stopped at the " << (time_out ? "time" : "node") << " limit after "
+                      << stats.nodes << " nodes, the enumeration is not complete.\n";
+        } else {
+            std::cout << "Search complete after " << stats.nodes << " nodes.\n";
+        }
+    }
+    if (options.print_stats) {
+        std::cout.flush();
+        stats.Print(std::cerr);
     }
     
     // delete the tiles
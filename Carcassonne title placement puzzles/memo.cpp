@@ -0,0 +1,60 @@
+#include <cassert>
+#include <vector>
+
+#include "memo.h"
+
+
+// ==========================================================================
+// CONSTRUCTOR
+TranspositionTable::TranspositionTable(int megabytes) : num_entries(0) {
+  assert (megabytes >= 0);
+  // the number of buckets is the largest power of 2 that fits
+  unsigned long long bytes = (unsigned long long)megabytes << 20;
+  unsigned long long buckets = 1;
+  while (2 * buckets * 2 * sizeof(Entry) <= bytes) {
+    buckets *= 2;
+  }
+  Entry empty = { 0, 0 };
+  entries = std::vector<Entry>(2 * buckets, empty);
+  bucket_mask = buckets - 1;
+}
+
+
+// ==========================================================================
+bool TranspositionTable::lookup(unsigned long long key) const {
+  const Entry *bucket = &entries[2 * (key & bucket_mask)];
+  for (int e = 0; e < 2; e++) {
+    if (bucket[e].work != 0 && bucket[e].key == key) return true;
+  }
+  return false;
+}
+
+
+void TranspositionTable::store(unsigned long long key, long long work) {
+  assert (work > 0);
+  Entry *bucket = &entries[2 * (key & bucket_mask)];
+  // the same key again, or an empty entry
+  for (int e = 0; e < 2; e++) {
+    if (bucket[e].work != 0 && bucket[e].key == key) {
+      if (work > bucket[e].work) bucket[e].work = work;
+      return;
+    }
+  }
+  for (int e = 0; e < 2; e++) {
+    if (bucket[e].work == 0) {
+      Entry tmp = { key, work };
+      bucket[e] = tmp;
+      num_entries++;
+      return;
+    }
+  }
+  // a full bucket: the first entry is the costliest one seen, the second
+  // the most recent one
+  Entry tmp = { key, work };
+  if (work >= bucket[0].work) {
+    bucket[1] = bucket[0];
+    bucket[0] = tmp;
+  } else {
+    bucket[1] = tmp;
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef __MEMO_H__
+#define __MEMO_H__
+
+#include <vector>
+
+
+// A transposition table of dead ends: the nodes of a search that were
+// searched to the end without a solution below them, by a 64 bit key of
+// the node (see Board::getKey).  Nothing else is kept, so a node with
+// solutions below it is searched again every time it is reached.  (How
+// many distinct solutions lie below a node depends on the tiles already
+// placed, see SolutionCounter, so counts could not be reused anyway.)
+//
+// The memory is fixed when the table is made.  Entries are kept in
+// buckets of 2: the first holds the entry that took the most work to
+// find (search nodes), the second the most recent one, so a full bucket
+// evicts its second entry.
+
+class TranspositionTable {
+public:
+  // uses at most about "megabytes" of memory (and at least one bucket)
+  TranspositionTable(int megabytes);
+
+  // true if the node with this key is known to be a dead end
+  bool lookup(unsigned long long key) const;
+  // work is the number of search nodes it took to find out
+  void store(unsigned long long key, long long work);
+
+  int numEntries() const { return num_entries; }
+
+private:
+
+  struct Entry {
+    unsigned long long key;
+    // 0 for an empty entry
+    long long work;
+  };
+
+  // REPRESENTATION
+  std::vector<Entry> entries;
+  unsigned long long bucket_mask;
+  int num_entries;
+};
+
+
+#endif
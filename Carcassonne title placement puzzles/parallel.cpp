@@ -0,0 +1,135 @@
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+
+// ==========================================================================
+// Task queues with work stealing: every worker pops from the back of its
+// own queue, and steals from the front of the others.
+class TaskQueues {
+public:
+  TaskQueues(int num_queues) : queues(num_queues), locks(num_queues) {}
+
+  void push(int queue, int task) { queues[queue].push_back(task); }
+
+  // returns -1 once every queue is empty (no tasks are added while running)
+  int pop(int queue) {
+    {
+      std::lock_guard<std::mutex> guard(locks[queue]);
+      if (!queues[queue].empty()) {
+        int task = queues[queue].back();
+        queues[queue].pop_back();
+        return task;
+      }
+    }
+    for (int i = 1; i < queues.size(); i++) {
+      int victim = (queue + i) % queues.size();
+      std::lock_guard<std::mutex> guard(locks[victim]);
+      if (!queues[victim].empty()) {
+        int task = queues[victim].front();
+        queues[victim].pop_front();
+        return task;
+      }
+    }
+    return -1;
+  }
+
+private:
+  std::vector<std::deque<int> > queues;
+  std::vector<std::mutex> locks;
+};
+
+
+// ==========================================================================
+// Serializes the calls to the real visitor, and raises the shared cancel
+// flag once it asks to stop.
+class LockedVisitor : public SolutionVisitor {
+public:
+  LockedVisitor(SolutionVisitor &v, std::atomic<bool> &s) : visitor(v), stop(s) {}
+
+  bool Visit(const Board &board, const std::vector<Location> &locations) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (stop) return true;
+    if (visitor.Visit(board, locations)) {
+      stop = true;
+    }
+    return stop;
+  }
+
+private:
+  SolutionVisitor &visitor;
+  std::atomic<bool> &stop;
+  std::mutex lock;
+};
+
+
+// ==========================================================================
+ParallelSearch::ParallelSearch(int r, int c, const TileInventory &inv, int threads, int depth) :
+  rows(r), columns(c), inventory(inv), num_threads(threads), split_depth(depth),
+  memo_megabytes(0), stats(NULL) {
+  assert (num_threads >= 1);
+  assert (split_depth >= 1);
+}
+
+
+bool ParallelSearch::Search(SolutionVisitor &visitor) {
+
+  // cut the search tree into tasks
+  std::vector<SearchTask> tasks;
+  {
+    Board board(rows, columns);
+    CellSearch search(board, inventory);
+    search.Collect_tasks(split_depth, tasks);
+  }
+
+  // deal them out round robin, so every queue gets a share of each anchor
+  TaskQueues queues(num_threads);
+  for (int t = 0; t < tasks.size(); t++) {
+    queues.push(t % num_threads, t);
+  }
+
+  std::atomic<bool> stop(false);
+  LockedVisitor locked(visitor, stop);
+
+  std::mutex stats_lock;
+  std::vector<std::thread> workers;
+  for (int w = 0; w < num_threads; w++) {
+    workers.push_back(std::thread([&, w]() {
+      Board board(rows, columns);
+      CellSearch search(board, inventory);
+      search.setCancelFlag(&stop);
+      // a table per worker, lookups need no locking
+      TranspositionTable memo(memo_megabytes);
+      if (memo_megabytes > 0) search.setMemo(&memo);
+      // and stats, added up at the end
+      SearchStats budget;
+      if (stats != NULL) {
+        budget.node_limit = (stats->node_limit + num_threads - 1) / num_threads;
+        budget.time_limit = stats->time_limit;
+        budget.start = stats->start;
+        search.setStats(&budget);
+      }
+      std::vector<Location> locations;
+      for (int t = queues.pop(w); t != -1 && !stop; t = queues.pop(w)) {
+        search.Resume(tasks[t], locations, locked);
+        if (budget.out_of_budget) stop = true;
+      }
+      if (stats != NULL) {
+        std::lock_guard<std::mutex> guard(stats_lock);
+        stats->nodes += budget.nodes;
+        if (budget.out_of_budget) stats->out_of_budget = true;
+      }
+    }));
+  }
+  for (int w = 0; w < workers.size(); w++) {
+    workers[w].join();
+  }
+  return stop;
+}
+
+// ==========================================================================
@@ -0,0 +1,45 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <vector>
+#include "solver.h"
+
+
+// Runs the cell ordered search on several threads.  The search tree is
+// cut at "split_depth" placed tiles into independent tasks, which are
+// dealt out to per-thread queues.  Each worker searches its tasks on its
+// own Board, and steals from the other queues once its own runs dry.
+// Calls to the visitor are serialized, so a visitor written for the
+// single threaded search (printing, dedup set) can be used as is.
+
+class ParallelSearch {
+public:
+  ParallelSearch(int rows, int columns, const TileInventory &inventory, int num_threads, int split_depth);
+
+  // Same contract as CellSearch::Search, except that the board handed to
+  // the visitor belongs to a worker thread.  Once the visitor asks to
+  // stop, the other workers give up as soon as they notice.
+  bool Search(SolutionVisitor &visitor);
+
+  // gives every worker a transposition table of this size (0 for none)
+  void setMemoSize(int megabytes) { memo_megabytes = megabytes; }
+
+  // The nodes of all the workers are added to these.  Every worker keeps
+  // to the time limit, and to an even share of the node limit; once one
+  // of them runs out the others stop too.  (NULL, the default, for none)
+  void setStats(SearchStats *s) { stats = s; }
+
+private:
+
+  // REPRESENTATION
+  int rows;
+  int columns;
+  const TileInventory &inventory;
+  int num_threads;
+  int split_depth;
+  int memo_megabytes;
+  SearchStats *stats;
+};
+
+
+#endif
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include "puzzle_generator.h"
+
+
+// layouts made per puzzle, the one closest to the duplicate ratio is kept
+static const int LAYOUTS_PER_PUZZLE = 20;
+// edges drawn again per layout before it is given up for another one
+static const int MAX_REDRAWS = 1000;
+
+
+// ==========================================================================
+// One connected layout: cells[t] is the cell (row * columns + column) of
+// tile t, tile_at the tile in each cell or -1.
+static void Random_layout(const PuzzleFamily &family, MTRand &mtrand,
+                          std::vector<int> &cells, std::vector<int> &tile_at) {
+  int rows = family.rows;
+  int columns = family.columns;
+  cells.clear();
+  tile_at.assign(rows * columns, -1);
+  std::vector<bool> in_frontier(rows * columns, false);
+  std::vector<int> frontier(1, mtrand.randInt(rows * columns - 1));
+  in_frontier[frontier[0]] = true;
+  while (cells.size() < family.num_tiles) {
+    assert (!frontier.empty());
+    int f = mtrand.randInt(frontier.size() - 1);
+    int cell = frontier[f];
+    frontier[f] = frontier.back();
+    frontier.pop_back();
+    tile_at[cell] = cells.size();
+    cells.push_back(cell);
+    int i = cell / columns;
+    int j = cell % columns;
+    int neighbors[4][2] = { { i - 1, j }, { i, j + 1 }, { i + 1, j }, { i, j - 1 } };
+    for (int side = NORTH; side <= WEST; side++) {
+      int ni = neighbors[side][0];
+      int nj = neighbors[side][1];
+      if (ni < 0 || ni >= rows || nj < 0 || nj >= columns) continue;
+      int next = ni * columns + nj;
+      if (tile_at[next] != -1 || in_frontier[next]) continue;
+      in_frontier[next] = true;
+      frontier.push_back(next);
+    }
+  }
+}
+
+
+// the tile next to a tile of the layout, or -1
+static int Neighbor(const PuzzleFamily &family, const std::vector<int> &cells,
+                    const std::vector<int> &tile_at, int t, int side) {
+  int i = cells[t] / family.columns;
+  int j = cells[t] % family.columns;
+  if (side == NORTH) i--;
+  if (side == EAST) j++;
+  if (side == SOUTH) i++;
+  if (side == WEST) j--;
+  if (i < 0 || i >= family.rows || j < 0 || j >= family.columns) return -1;
+  return tile_at[i * family.columns + j];
+}
+
+
+static EdgeType Random_edge(MTRand &mtrand, double pasture_chance) {
+  if (mtrand.rand() < pasture_chance) return PASTURE;
+  return mtrand.randInt(1) == 0 ? ROAD : CITY;
+}
+
+
+// puts the same edge on both tiles
+static void Set_edge(std::vector<EdgeCode> &codes, int t, int side, int other, EdgeType edge) {
+  codes[t] = EdgeCode((codes[t] & ~(3 << (2 * side))) | (edge << (2 * side)));
+  int opposite = oppositeSide(side);
+  codes[other] = EdgeCode((codes[other] & ~(3 << (2 * opposite))) | (edge << (2 * opposite)));
+}
+
+
+// ==========================================================================
+// Draws the edges of a layout, false if no legal tiles came out of it.
+static bool Draw_edges(const PuzzleFamily &family, MTRand &mtrand, const std::vector<int> &cells,
+                       const std::vector<int> &tile_at, std::vector<EdgeCode> &codes) {
+  double pasture_chance = std::min(std::max(family.duplicate_ratio, 0.0), 1.0);
+  codes.assign(cells.size(), 0);
+  for (int t = 0; t < cells.size(); t++) {
+    for (int side = EAST; side <= SOUTH; side++) {
+      int other = Neighbor(family, cells, tile_at, t, side);
+      if (other != -1) Set_edge(codes, t, side, other, Random_edge(mtrand, pasture_chance));
+    }
+  }
+  // the edges of an illegal tile are drawn again (which may spoil one of
+  // its neighbors) until every tile is legal
+  std::vector<int> illegal;
+  for (int redraw = 0; redraw < MAX_REDRAWS; redraw++) {
+    illegal.clear();
+    for (int t = 0; t < codes.size(); t++) {
+      if (Tile::checkCode(codes[t]) != NULL) illegal.push_back(t);
+    }
+    if (illegal.empty()) return true;
+    int t = illegal[mtrand.randInt(illegal.size() - 1)];
+    for (int side = NORTH; side <= WEST; side++) {
+      int other = Neighbor(family, cells, tile_at, t, side);
+      if (other != -1) Set_edge(codes, t, side, other, Random_edge(mtrand, pasture_chance));
+    }
+  }
+  return false;
+}
+
+
+// ==========================================================================
+void GeneratePuzzle(const PuzzleFamily &family, MTRand &mtrand, std::vector<EdgeCode> &codes) {
+  assert (family.num_tiles >= 1);
+  assert (family.rows >= 1 && family.columns >= 1);
+  assert (family.num_tiles <= family.rows * family.columns);
+
+  std::vector<int> cells, tile_at;
+  std::vector<EdgeCode> tmp;
+  double best_error = 2;
+  codes.clear();
+  for (int layout = 0; layout < LAYOUTS_PER_PUZZLE || codes.empty(); layout++) {
+    Random_layout(family, mtrand, cells, tile_at);
+    if (!Draw_edges(family, mtrand, cells, tile_at, tmp)) continue;
+    double error = fabs(DuplicateRatio(tmp, family.allow_rotations) - family.duplicate_ratio);
+    if (error < best_error) {
+      best_error = error;
+      codes = tmp;
+    }
+  }
+
+  // the solution must not be handed out in order (or unturned)
+  for (int t = codes.size() - 1; t > 0; t--) {
+    std::swap(codes[t], codes[mtrand.randInt(t)]);
+  }
+  if (family.allow_rotations) {
+    for (int t = 0; t < codes.size(); t++) {
+      codes[t] = rotateCode(codes[t], mtrand.randInt(3));
+    }
+  }
+}
+
+
+// ==========================================================================
+double DuplicateRatio(const std::vector<EdgeCode> &codes, bool allow_rotations) {
+  if (codes.empty()) return 0;
+  std::set<EdgeCode> kinds;
+  for (int t = 0; t < codes.size(); t++) {
+    EdgeCode code = codes[t];
+    for (int turns = 1; allow_rotations && turns < 4; turns++) {
+      code = std::min(code, rotateCode(codes[t], turns));
+    }
+    kinds.insert(code);
+  }
+  return double(codes.size() - kinds.size()) / codes.size();
+}
@@ -0,0 +1,40 @@
+#ifndef __PUZZLE_GENERATOR_H__
+#define __PUZZLE_GENERATOR_H__
+
+#include <vector>
+#include "MersenneTwister.h"
+#include "tile.h"
+
+
+// What kind of puzzles to make: how many tiles, the board they are laid
+// out on, about how many of them are copies of another tile, and whether
+// they are handed out turned (so only -allow_rotations can solve them).
+struct PuzzleFamily {
+  int num_tiles;
+  int rows;
+  int columns;
+  double duplicate_ratio;
+  bool allow_rotations;
+};
+
+
+// Makes a random puzzle of the family that has at least one solution.
+// Like RandomlyPlaceTiles in main.cpp, cells are drawn at random with
+// mtrand, but only the empty cells next to the tiles placed so far, so
+// the layout is one connected group on the board.  Every edge between two
+// tiles of the layout gets a random type (pasture more often the higher
+// the duplicate ratio, which makes more tiles alike), every other edge is
+// pasture, and edges are drawn again until every tile is legal (see
+// Tile::checkCode).  The best of a few such layouts for the duplicate
+// ratio is kept, then the tiles are shuffled (and turned, with
+// rotations).
+//
+// codes is set to the edges of the tiles, in file order.
+void GeneratePuzzle(const PuzzleFamily &family, MTRand &mtrand, std::vector<EdgeCode> &codes);
+
+// the fraction of the tiles that are a copy of another one (up to a turn,
+// with rotations), 0 if all are different
+double DuplicateRatio(const std::vector<EdgeCode> &codes, bool allow_rotations);
+
+
+#endif
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <string>
+
+#include "solution_set.h"
+
+
+// one placed tile of a layout, ordered by position
+struct PlacedTile {
+  int row;
+  int column;
+  EdgeCode code;
+  bool operator<(const PlacedTile &other) const {
+    if (row != other.row) return row < other.row;
+    return column < other.column;
+  }
+};
+
+
+// ==========================================================================
+SolutionSet::SolutionSet(const std::vector<Tile*> &t, bool rotations) :
+  tiles(t), allow_rotations(rotations) {}
+
+
+bool SolutionSet::insert(const std::vector<Location> &locations) {
+  return forms.insert(canonical(locations)).second;
+}
+
+
+// one form per line, its bytes in hex
+void SolutionSet::Save(std::ostream &ostr) const {
+  static const char *digits = "0123456789abcdef";
+  ostr << "forms " << forms.size() << "\n";
+  std::string line;
+  for (std::unordered_set<std::string>::const_iterator itr = forms.begin(); itr != forms.end(); ++itr) {
+    line.clear();
+    for (int c = 0; c < itr->size(); c++) {
+      line += digits[((unsigned char)(*itr)[c]) >> 4];
+      line += digits[((unsigned char)(*itr)[c]) & 15];
+    }
+    ostr << line << "\n";
+  }
+}
+
+
+bool SolutionSet::Load(std::istream &istr) {
+  std::string word, line;
+  int num_forms;
+  if (!(istr >> word >> num_forms) || word != "forms" || num_forms < 0) return false;
+  forms.reserve(forms.size() + num_forms);
+  for (int f = 0; f < num_forms; f++) {
+    // every form is 5 bytes per tile
+    if (!(istr >> line) || line.size() != 10 * tiles.size()) return false;
+    std::string form(line.size() / 2, '\0');
+    for (int c = 0; c < line.size(); c++) {
+      int digit;
+      if (line[c] >= '0' && line[c] <= '9') digit = line[c] - '0';
+      else if (line[c] >= 'a' && line[c] <= 'f') digit = line[c] - 'a' + 10;
+      else return false;
+      form[c / 2] = char((form[c / 2] << 4) | digit);
+    }
+    forms.insert(form);
+  }
+  return true;
+}
+
+
+// ==========================================================================
+// the placed tiles of a solution, with the edges as they lie on the board
+static std::vector<PlacedTile> Make_layout(const std::vector<Tile*> &tiles,
+                                           const std::vector<Location> &locations) {
+  assert (locations.size() == tiles.size());
+  std::vector<PlacedTile> layout(locations.size());
+  for (int t = 0; t < locations.size(); t++) {
+    layout[t].row = locations[t].row;
+    layout[t].column = locations[t].column;
+    layout[t].code = rotateCode(tiles[t]->getCode(), locations[t].rotation / 90);
+  }
+  return layout;
+}
+
+
+// turns the whole layout clockwise by 90 degrees, in place
+static void Turn_layout(std::vector<PlacedTile> &layout) {
+  for (int t = 0; t < layout.size(); t++) {
+    int row = layout[t].row;
+    layout[t].row = layout[t].column;
+    layout[t].column = -row;
+    layout[t].code = rotateCode(layout[t].code, 1);
+  }
+}
+
+
+// translates a layout to the origin and sorts it by position, height and
+// width are set to the size of its bounding box
+static std::vector<PlacedTile> Normalize_layout(const std::vector<PlacedTile> &layout, int &height, int &width) {
+  int min_row = INT_MAX, min_column = INT_MAX;
+  int max_row = INT_MIN, max_column = INT_MIN;
+  for (int t = 0; t < layout.size(); t++) {
+    min_row = std::min(min_row, layout[t].row);
+    min_column = std::min(min_column, layout[t].column);
+    max_row = std::max(max_row, layout[t].row);
+    max_column = std::max(max_column, layout[t].column);
+  }
+  height = max_row - min_row + 1;
+  width = max_column - min_column + 1;
+  std::vector<PlacedTile> form(layout);
+  for (int t = 0; t < form.size(); t++) {
+    form[t].row -= min_row;
+    form[t].column -= min_column;
+  }
+  std::sort(form.begin(), form.end());
+  return form;
+}
+
+
+// 2 bytes for the row and the column, 1 for the edges
+static std::string Form_key(const std::vector<PlacedTile> &form) {
+  std::string key;
+  key.reserve(5 * form.size());
+  for (int t = 0; t < form.size(); t++) {
+    assert (form[t].row < 65536 && form[t].column < 65536);
+    key += char(form[t].row >> 8);
+    key += char(form[t].row & 255);
+    key += char(form[t].column >> 8);
+    key += char(form[t].column & 255);
+    key += char(form[t].code);
+  }
+  return key;
+}
+
+
+// ==========================================================================
+std::string SolutionSet::canonical(const std::vector<Location> &locations) const {
+  std::vector<PlacedTile> layout = Make_layout(tiles, locations);
+
+  std::string answer;
+  int num_turns = allow_rotations ? 4 : 1;
+  for (int n = 0; n < num_turns; n++) {
+    if (n > 0) Turn_layout(layout);
+    int height, width;
+    std::string key = Form_key(Normalize_layout(layout, height, width));
+    if (n == 0 || key < answer) {
+      answer = key;
+    }
+  }
+  return answer;
+}
+
+
+// ==========================================================================
+SolutionCounter::SolutionCounter(const std::vector<Tile*> &t, const TileInventory &inv, int r, int c) :
+  tiles(t), inventory(inv), rows(r), columns(c), count(0) {}
+
+
+bool SolutionCounter::insert(const std::vector<Location> &locations) {
+  std::vector<PlacedTile> layout = Make_layout(tiles, locations);
+  int height, width;
+  std::string own = Form_key(Normalize_layout(layout, height, width));
+
+  // Only a rotation of the whole board can give the same solution again.
+  // Of the turns the search reports too (the ones that fit the board and
+  // keep every tile in an orientation the search allows), the one with the
+  // smallest form is the one counted.
+  if (inventory.allowsRotations()) {
+    for (int n = 1; n < 4; n++) {
+      Turn_layout(layout);
+      int h, w;
+      std::vector<PlacedTile> form = Normalize_layout(layout, h, w);
+      if (h > rows || w > columns) continue;
+      bool allowed = true;
+      for (int t = 0; t < form.size() && allowed; t++) {
+        allowed = inventory.allowsCode(form[t].code);
+      }
+      if (allowed && Form_key(form) < own) return false;
+    }
+  }
+
+  count++;
+  histogram[std::make_pair(height, width)]++;
+  return true;
+}
+
+
+void SolutionCounter::Save(std::ostream &ostr) const {
+  ostr << "count " << count << " " << histogram.size() << "\n";
+  for (std::map<std::pair<int,int>, long long>::const_iterator itr = histogram.begin(); itr != histogram.end(); ++itr) {
+    ostr << itr->first.first << " " << itr->first.second << " " << itr->second << "\n";
+  }
+}
+
+
+bool SolutionCounter::Load(std::istream &istr) {
+  std::string word;
+  int num_sizes;
+  if (!(istr >> word >> count >> num_sizes) || word != "count" || num_sizes < 0) return false;
+  histogram.clear();
+  for (int n = 0; n < num_sizes; n++) {
+    int height, width;
+    long long number;
+    if (!(istr >> height >> width >> number)) return false;
+    histogram[std::make_pair(height, width)] = number;
+  }
+  return true;
+}
+
+
+// ==========================================================================
+SolutionTally::SolutionTally(SolutionMode m, const std::vector<Tile*> &tiles, const TileInventory &inventory,
+                             int rows, int columns) :
+  mode(m), all(NULL), counter(NULL), num_solutions(0), start(std::chrono::steady_clock::now()),
+  first_seconds(-1) {
+  if (mode == ALL_SOLUTIONS) all = new SolutionSet(tiles, inventory.allowsRotations());
+  if (mode == COUNT_SOLUTIONS) counter = new SolutionCounter(tiles, inventory, rows, columns);
+}
+
+
+SolutionTally::~SolutionTally() {
+  delete all;
+  delete counter;
+}
+
+
+bool SolutionTally::Visit(const Board &board, const std::vector<Location> &locations) {
+  if (first_seconds < 0) {
+    first_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    first = locations;
+  }
+  if (mode == FIRST_SOLUTION) {
+    num_solutions = 1;
+    return true;
+  }
+  if (mode == ALL_SOLUTIONS) {
+    if (all->insert(locations)) ++num_solutions;
+  } else {
+    counter->insert(locations);
+    num_solutions = counter->size();
+  }
+  return false; // keep going
+}
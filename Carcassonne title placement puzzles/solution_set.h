@@ -0,0 +1,132 @@
+#ifndef __SOLUTION_SET_H__
+#define __SOLUTION_SET_H__
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unordered_set>
+#include "tile.h"
+#include "location.h"
+#include "inventory.h"
+#include "solver.h"
+
+
+// This class remembers the solutions found so far by their canonical
+// form: the placed tiles (as edge codes) translated so the layout starts
+// at row 0 / column 0 and sorted by position.  With rotations allowed,
+// the smallest form over the 4 rotations of the whole layout is used.
+// Solutions that only differ by a translation, a rotation of the board
+// or by identical tiles trading places share one canonical form.
+
+class SolutionSet {
+public:
+
+  SolutionSet(const std::vector<Tile*> &tiles, bool allow_rotations);
+
+  // returns true if this solution had not been seen before
+  bool insert(const std::vector<Location> &locations);
+
+  int size() const { return forms.size(); }
+
+  // builds the canonical form of a solution, O(t log t)
+  std::string canonical(const std::vector<Location> &locations) const;
+
+  // writes the forms out as text (for checkpoints), and reads them back
+  // in addition to the ones already here; false if the text is not right
+  void Save(std::ostream &ostr) const;
+  bool Load(std::istream &istr);
+
+private:
+
+  // REPRESENTATION
+  const std::vector<Tile*> &tiles;
+  bool allow_rotations;
+  std::unordered_set<std::string> forms;
+};
+
+
+
+// Counts the distinct solutions without keeping them, for the searches
+// that report every layout once in the top left corner of the board (see
+// Can_reach_corner), so translations and identical tiles never come up
+// twice.  Rotations of the whole board still can, so of those the search
+// reports only the one with the smallest canonical form is counted.
+// Memory does not grow with the number of solutions.
+
+class SolutionCounter {
+public:
+
+  // rows and columns of the board that was searched
+  SolutionCounter(const std::vector<Tile*> &tiles, const TileInventory &inventory, int rows, int columns);
+
+  // returns true if the solution was counted
+  bool insert(const std::vector<Location> &locations);
+
+  long long size() const { return count; }
+  // distinct solutions per (height, width) of their bounding box
+  const std::map<std::pair<int,int>, long long>& getHistogram() const { return histogram; }
+
+  // writes the count and histogram out as text (for checkpoints), and
+  // reads them back in their place; false if the text is not right
+  void Save(std::ostream &ostr) const;
+  bool Load(std::istream &istr);
+
+private:
+
+  // REPRESENTATION
+  const std::vector<Tile*> &tiles;
+  const TileInventory &inventory;
+  int rows;
+  int columns;
+  long long count;
+  std::map<std::pair<int,int>, long long> histogram;
+};
+
+
+// What to find: the first solution, every distinct one (SolutionSet) or
+// just how many there are (SolutionCounter).
+enum SolutionMode { FIRST_SOLUTION, ALL_SOLUTIONS, COUNT_SOLUTIONS };
+
+// A visitor that counts the solutions of a search in one of the modes,
+// and keeps the first solution found and when it turned up.  Only the set
+// or counter the mode needs is made.  Used where the solutions are not
+// printed as they come: the batch mode of main.cpp and the benchmark.
+
+class SolutionTally : public SolutionVisitor {
+public:
+  // rows and columns of the board that is searched
+  SolutionTally(SolutionMode mode, const std::vector<Tile*> &tiles, const TileInventory &inventory,
+                int rows, int columns);
+  ~SolutionTally();
+
+  bool Visit(const Board &board, const std::vector<Location> &locations);
+
+  long long numSolutions() const { return num_solutions; }
+  // empty if there was none
+  const std::vector<Location>& firstSolution() const { return first; }
+  // seconds from the making of the tally to the first solution, -1 if
+  // there was none
+  double firstSeconds() const { return first_seconds; }
+
+private:
+
+  // not copied, it owns the set or counter
+  SolutionTally(const SolutionTally&);
+  SolutionTally& operator=(const SolutionTally&);
+
+  // REPRESENTATION
+  SolutionMode mode;
+  // NULL unless the mode needs it
+  SolutionSet *all;
+  SolutionCounter *counter;
+  long long num_solutions;
+  std::vector<Location> first;
+  std::chrono::steady_clock::time_point start;
+  double first_seconds;
+};
+
+
+#endif
@@ -0,0 +1,563 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <iomanip>
+#include <vector>
+
+#include "MersenneTwister.h"
+#include "solver.h"
+#include "checkpoint.h"
+
+
+//---------------------------------------------------------------------------------------
+// This function is used for checking the whole layout of the board after all the tiles have been used up.
+// Every road or city edge has to meet the same edge of a neighbor, edges on the border or next to an
+// empty cell are pasture, and the tiles form one connected group.  The board keeps count of all three
+// as tiles are placed and erased, so this is O(1) instead of a scan of the board.
+bool Check_the_whole_board(const Board &board) {
+    return (board.numOpenEdges() == 0 &&
+            board.numMismatches() == 0 &&
+            board.numComponents() <= 1);
+}
+//---------------------------------------------------------------------
+// This function is used for checking the requirements of the current tile
+bool Check_tile(const Board &board, const Tile* tmp, int cell) {
+    
+    // The edges next to tiles already placed must be the same as theirs.
+    // The border of the board and blocked cells count as pasture.  The
+    // board keeps these requirements per cell, so this is one mask compare.
+    //----------------------------------------------------------------------------
+    return board.fits(cell, tmp->getCode());
+}
+
+
+//---------------------------------------------------------------------
+// Every road or city edge of the finished layout meets the same edge of the
+// tile next to it.  Without rotations a north road always pairs with a south
+// road, so the north roads left over (after the empty cells that need one)
+// must be exactly as many as the south roads left over, same for the other
+// axis and for cities.  With rotations only the totals are fixed: the road
+// edges left and the open ones have to pair up, so there must be enough of
+// them and an even number altogether.
+bool Can_still_close(const Board &board, const EdgeSupply &supply, bool allow_rotations, int tiles_left) {
+    
+    // every empty cell a road or city runs into needs a tile of its own
+    for (int side = NORTH; side <= WEST; ++side) {
+        if (board.numOpenNeeds(side, ROAD) + board.numOpenNeeds(side, CITY) > tiles_left) return false;
+    }
+    
+    for (int type = ROAD; type <= CITY; ++type) {
+        EdgeType t = (EdgeType)type;
+        if (allow_rotations) {
+            int open = 0, left = 0;
+            for (int side = NORTH; side <= WEST; ++side) {
+                open += board.numOpenNeeds(side, t);
+                left += supply.count[side][t];
+            }
+            if (left < open || (left - open) % 2 != 0) return false;
+        } else {
+            for (int side = NORTH; side <= EAST; ++side) {
+                int spare = supply.count[side][t] - board.numOpenNeeds(side, t);
+                int opposite = oppositeSide(side);
+                int spare_opposite = supply.count[opposite][t] - board.numOpenNeeds(opposite, t);
+                if (spare < 0 || spare_opposite < 0 || spare != spare_opposite) return false;
+            }
+        }
+    }
+    
+    // a tile joins at most 4 pieces of the layout into one
+    return board.numComponents() - 1 <= 3 * tiles_left;
+}
+
+
+//---------------------------------------------------------------------
+// Each tile added to a connected layout moves its top (or left) side by
+// at most one cell, so the layout can only still touch row 0 and column 0
+// if it is no further away from them than there are tiles left.
+bool Can_reach_corner(int top_row, int left_column, int tiles_left) {
+    return top_row <= tiles_left && left_column <= tiles_left;
+}
+
+
+//---------------------------------------------------------------------
+// Why Check_tile turned the tile down: a side facing the border (or a
+// blocked cell) that is not pasture comes first, then the first side
+// that does not match its neighbor.
+static RejectReason Reject_reason(const Board &board, const Tile* tmp, int cell) {
+    EdgeCode wrong = (tmp->getCode() & board.constrainedSides(cell)) ^ board.requiredEdges(cell);
+    int first_side = -1;
+    for (int side = NORTH; side <= WEST; ++side) {
+        if (getEdge(wrong, side) == 0) continue;
+        if (board.getNeighbor(cell, side) == Board::sentinel()) return REJECT_BORDER;
+        if (first_side == -1) first_side = side;
+    }
+    assert (first_side != -1);
+    return RejectReason(REJECT_NORTH + first_side);
+}
+
+
+// ==========================================================================
+void Prepare_search(TileInventory &inventory, int &rows, int &columns) {
+    rows = std::min(rows, inventory.numTiles());
+    columns = std::min(columns, inventory.numTiles());
+    inventory.breakRotationSymmetry(rows == columns);
+}
+
+
+// ==========================================================================
+// TILE ORDERED SEARCH
+static bool Place_tile(Board &board, const TileInventory &inventory, std::vector<Location> &locations, int index,
+                       SolutionVisitor &visitor, SearchStats *stats, SearchCheckpoint *checkpoint);
+
+bool Can_place(Board &board, const TileInventory &inventory, std::vector<Location> &locations, int index, SolutionVisitor &visitor,
+               SearchStats *stats, SearchCheckpoint *checkpoint) {
+    
+    if (checkpoint != NULL) checkpoint->Enter(index, stats);
+    if (stats == NULL) return Place_tile(board, inventory, locations, index, visitor, NULL, checkpoint);
+    if (stats->Over_budget()) {
+        if (checkpoint != NULL) checkpoint->Out_of_budget(index, stats);
+        return true;
+    }
+    stats->nodes++;
+    if (!stats->per_depth) return Place_tile(board, inventory, locations, index, visitor, stats, checkpoint);
+    
+    // a row per depth, made up front so they stay put while the nodes below run
+    if (stats->depths.size() <= inventory.numTiles()) stats->depths.resize(inventory.numTiles() + 1);
+    stats->depths[index].nodes++;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool stop = Place_tile(board, inventory, locations, index, visitor, stats, checkpoint);
+    stats->depths[index].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stop;
+}
+
+
+// one node of the tile ordered search, stats (if any) has a row for it
+// when it asks for depths
+static bool Place_tile(Board &board, const TileInventory &inventory, std::vector<Location> &locations, int index,
+                       SolutionVisitor &visitor, SearchStats *stats, SearchCheckpoint *checkpoint) {
+    
+    DepthStats *depth = (stats != NULL && stats->per_depth) ? &stats->depths[index] : NULL;
+    
+    // Only layouts in the top left corner of the board are looked for,
+    // the same layout moved to other cells is not a new one.
+    if (index > 0) {
+        int top_row = board.numRows();
+        int left_column = board.numColumns();
+        for (int p = 0; p < index; ++p) {
+            const Location &tmp = locations[inventory.getTileIndex(inventory.kindAt(p), inventory.copyAt(p))];
+            top_row = std::min(top_row, tmp.row);
+            left_column = std::min(left_column, tmp.column);
+        }
+        if (!Can_reach_corner(top_row, left_column, inventory.numTiles() - index)) {
+            if (depth != NULL) depth->corner_prunes++;
+            return false;   // DEAD END
+        }
+    }
+    
+    // If all the tiles have been used up:
+    if (index == inventory.numTiles()) {
+        if (depth != NULL) depth->leaves++;
+        // check if solution, and pass it on.
+        if (Check_the_whole_board(board)) {
+            return visitor.Visit(board, locations);
+        } else {
+            if (depth != NULL) depth->leaves_rejected++;
+            return false;
+        }
+    } else {
+        if (!Can_still_close(board, inventory.getSupplyFrom(index), inventory.allowsRotations(),
+                             inventory.numTiles() - index)) {
+            if (depth != NULL) depth->close_prunes++;
+            return false;   // DEAD END
+        }
+        int kind = inventory.kindAt(index);
+        int copy = inventory.copyAt(index);
+        int tile_index = inventory.getTileIndex(kind, copy);
+        
+        // Copies of the same kind are placed on increasing cells, so identical
+        // tiles never trade places.
+        int first_cell = 0;
+        if (copy > 0) {
+            const Location &prev = locations[inventory.getTileIndex(kind, copy - 1)];
+            first_cell = prev.row * board.numColumns() + prev.column + 1;
+        }
+        // A resumed search starts where the saved one was.
+        int first_k = 0;
+        if (checkpoint != NULL) checkpoint->Resuming(index, first_cell, first_k);
+        
+        for (int cell = first_cell; cell < board.numRows() * board.numColumns(); ++cell) {
+            int i = cell / board.numColumns();
+            int j = cell % board.numColumns();
+            int flat = board.index(i, j);
+            if (board.isOccupied(flat)) continue;
+            // Only the distinct orientations of the kind (just one without rotations)
+            for (int k = (cell == first_cell ? first_k : 0); k < inventory.numOrientations(kind); ++k) {
+                if (!(inventory.getAllowedOrientations(kind) & (1 << k))) continue;
+                Tile* tmp = inventory.getOrientation(kind, k);
+                
+                // Check whether the current tile meets the requirements
+                //------------------------------------------------------
+                if (Check_tile(board, tmp, flat)) {
+                    
+                    board.setCell(flat, tmp);
+                    locations[tile_index] = Location(i, j, inventory.getRotation(kind, k, copy));
+                    if (checkpoint != NULL) checkpoint->Step(index, cell, k);
+                    //-----------------------------------------------
+                    if (Can_place(board, inventory, locations, index + 1, visitor, stats, checkpoint)) {
+                        return true;
+                    }
+                    board.eraseCell(flat);
+                } else if (depth != NULL) {
+                    depth->rejections[Reject_reason(board, tmp, flat)]++;
+                }
+            }
+        }
+        //-----------------------------------------------------
+        return false;   // Search exhausted (or no solutions)
+        //-----------------------------------------------------
+    }
+}
+
+
+// ==========================================================================
+// CELL ORDERED SEARCH
+CellSearch::CellSearch(Board &b, const TileInventory &inv) :
+    board(b), inventory(inv), supply(inv.getSupplyFrom(0)),
+    top_row(0), bottom_row(-1), left_column(0), right_column(-1), locations(NULL), visitor(NULL), cancel(NULL),
+    tasks(NULL), task_depth(0), memo(NULL), remaining_key(0), num_nodes(0), num_visits(0),
+    stats(NULL) {
+    remaining = std::vector<int>(inventory.numKinds());
+    // the tiles left are keyed by the sum of a random number per tile
+    MTRand mtrand(1);
+    kind_keys = std::vector<unsigned long long>(inventory.numKinds());
+    for (int kind = 0; kind < inventory.numKinds(); ++kind) {
+        remaining[kind] = inventory.numCopies(kind);
+        kind_keys[kind] = (((unsigned long long)mtrand.randInt()) << 32) | mtrand.randInt();
+        remaining_key += kind_keys[kind] * remaining[kind];
+    }
+}
+
+
+bool CellSearch::Search(std::vector<Location> &l, SolutionVisitor &v) {
+    locations = &l;
+    visitor = &v;
+    locations->assign(inventory.numTiles(), Location());
+    return Search_anchors();
+}
+
+
+void CellSearch::Collect_tasks(int depth, std::vector<SearchTask> &t) {
+    assert (depth >= 1);
+    if (depth > inventory.numTiles()) depth = inventory.numTiles();
+    std::vector<Location> tmp(inventory.numTiles());
+    locations = &tmp;
+    tasks = &t;
+    task_depth = depth;
+    Search_anchors();
+    tasks = NULL;
+}
+
+
+bool CellSearch::Resume(const SearchTask &task, std::vector<Location> &l, SolutionVisitor &v) {
+    locations = &l;
+    visitor = &v;
+    locations->assign(inventory.numTiles(), Location());
+    
+    // replay the node: the tiles in the order they were placed (so copies
+    // are handed out the same way) and the cells left empty
+    for (int p = 0; p < task.placements.size(); ++p) {
+        const SearchTask::Placement &tmp = task.placements[p];
+        int copy = inventory.numCopies(tmp.kind) - remaining[tmp.kind];
+        board.setTile(tmp.row, tmp.column, inventory.getOrientation(tmp.kind, tmp.orientation));
+        (*locations)[inventory.getTileIndex(tmp.kind, copy)] =
+            Location(tmp.row, tmp.column, inventory.getRotation(tmp.kind, tmp.orientation, copy));
+        remaining[tmp.kind]--;
+        remaining_key -= kind_keys[tmp.kind];
+        supply.add(inventory.getOrientation(tmp.kind, 0)->getCode(), -1);
+        placed.push_back(tmp);
+        Grow_box(tmp.row, tmp.column);
+    }
+    for (int b = 0; b < task.blocked_cells.size(); ++b) {
+        int cell = task.blocked_cells[b];
+        board.block(board.index(cell / board.numColumns(), cell % board.numColumns()));
+    }
+    
+    bool stop = Fill(task.placements.size());
+    if (stop) return true;   // the board is left holding the solution
+    
+    for (int p = task.placements.size() - 1; p >= 0; --p) {
+        board.eraseTile(task.placements[p].row, task.placements[p].column);
+        remaining[task.placements[p].kind]++;
+        remaining_key += kind_keys[task.placements[p].kind];
+        supply.add(inventory.getOrientation(task.placements[p].kind, 0)->getCode(), 1);
+    }
+    placed.clear();
+    bottom_row = right_column = -1;
+    Unblock_all();
+    return false;
+}
+
+
+//---------------------------------------------------------------------
+bool CellSearch::Search_anchors() {
+    // Without tiles there is no anchor, the empty layout is the one
+    // solution (as for the other engines) and the root is the only node.
+    if (inventory.numTiles() == 0) return Fill(0);
+    
+    // The anchor is the first occupied cell in row major order, so every
+    // cell before it has to stay empty.  Layouts are kept in the top left
+    // corner of the board, so the anchor is in the top row.
+    bool stop = false;
+    for (int j = 0; j < board.numColumns() && !stop; ++j) {
+        int cell = board.index(0, j);
+        stop = Try_tiles(cell, 0);
+        if (!stop) board.block(cell);
+    }
+    if (!stop) Unblock_all();
+    return stop;
+}
+
+
+// stretches the bounding box over a cell, an empty box has bottom_row -1
+void CellSearch::Grow_box(int row, int column) {
+    if (bottom_row == -1) {
+        top_row = bottom_row = row;
+        left_column = right_column = column;
+        return;
+    }
+    if (row < top_row) top_row = row;
+    if (row > bottom_row) bottom_row = row;
+    if (column < left_column) left_column = column;
+    if (column > right_column) right_column = column;
+}
+
+
+void CellSearch::Unblock_all() {
+    for (int i = 0; i < board.numRows(); ++i) {
+        for (int j = 0; j < board.numColumns(); ++j) {
+            if (board.isBlocked(board.index(i, j))) board.unblock(board.index(i, j));
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------
+// Puts one copy of every kind of tile left (in each distinct orientation)
+// that fits into the cell and carries on from there.
+bool CellSearch::Try_tiles(int cell, int num_placed) {
+    int i = board.getRow(cell);
+    int j = board.getColumn(cell);
+    for (int kind = 0; kind < inventory.numKinds(); ++kind) {
+        if (remaining[kind] == 0) continue;
+        // all the orientations of the kind are tested at once
+        unsigned int fit = Fitting_orientations(cell, kind);
+        if (fit == 0) continue;
+        // copies are handed out in order, the next one up is used here
+        int copy = inventory.numCopies(kind) - remaining[kind];
+        int tile_index = inventory.getTileIndex(kind, copy);
+        EdgeCode code = inventory.getOrientation(kind, 0)->getCode();
+        int box[4] = { top_row, bottom_row, left_column, right_column };
+        for (int k = 0; k < inventory.numOrientations(kind); ++k) {
+            if (!(fit & (1 << k))) continue;
+            
+            board.setCell(cell, inventory.getOrientation(kind, k));
+            Grow_box(i, j);
+            (*locations)[tile_index] = Location(i, j, inventory.getRotation(kind, k, copy));
+            remaining[kind]--;
+            remaining_key -= kind_keys[kind];
+            supply.add(code, -1);
+            SearchTask::Placement placement = { i, j, kind, k };
+            placed.push_back(placement);
+            //-----------------------------------------------
+            if (Fill(num_placed + 1)) {
+                return true;
+            }
+            placed.pop_back();
+            top_row = box[0]; bottom_row = box[1]; left_column = box[2]; right_column = box[3];
+            supply.add(code, 1);
+            remaining_key += kind_keys[kind];
+            remaining[kind]++;
+            (*locations)[tile_index] = Location();
+            board.eraseCell(cell);
+        }
+    }
+    return false;
+}
+
+
+// bit k is set if orientation k of the kind fits the cell
+unsigned int CellSearch::Fitting_orientations(int cell, int kind) const {
+    return board.fitMask(cell, inventory.getOrientationWord(kind)) & inventory.getAllowedOrientations(kind);
+}
+
+
+//---------------------------------------------------------------------
+bool CellSearch::Fill(int num_placed) {
+    
+    if (cancel != NULL && *cancel) return true;
+    
+    // When collecting tasks, record this node instead of going further.
+    if (tasks != NULL && num_placed == task_depth) {
+        SearchTask task;
+        task.placements = placed;
+        for (int i = 0; i < board.numRows(); ++i) {
+            for (int j = 0; j < board.numColumns(); ++j) {
+                if (board.isBlocked(board.index(i, j))) task.blocked_cells.push_back(i * board.numColumns() + j);
+            }
+        }
+        tasks->push_back(task);
+        return false;
+    }
+    
+    if (memo == NULL || tasks != NULL) return Expand(num_placed);
+    
+    // A node already searched without a solution below it is skipped.  The
+    // key stands for the cells taken, the edges the empty cells must have
+    // and the tiles left, which is all the rest of the search depends on.
+    unsigned long long key = board.getKey() ^ remaining_key;
+    if (memo->lookup(key)) return false;
+    long long nodes = num_nodes;
+    long long visits = num_visits;
+    bool stop = Expand(num_placed);
+    if (!stop && num_visits == visits) memo->store(key, num_nodes - nodes);
+    return stop;
+}
+
+
+bool CellSearch::Expand(int num_placed) {
+    
+    if (stats != NULL) {
+        if (stats->Over_budget()) return true;
+        stats->nodes++;
+    }
+    num_nodes++;
+    
+    // The layout grows down from the top row, it must also get to the
+    // left column.
+    if (!Can_reach_corner(top_row, left_column, inventory.numTiles() - num_placed)) {
+        return false;   // DEAD END
+    }
+    
+    // If all the tiles have been used up, the layout is connected and
+    // matched by construction, only dangling roads or cities are left to check.
+    if (num_placed == inventory.numTiles()) {
+        if (!Check_the_whole_board(board)) return false;
+        num_visits++;
+        return visitor->Visit(board, *locations);
+    }
+    
+    // Give up early if the tiles left cannot close what is open.
+    if (!Can_still_close(board, supply, inventory.allowsRotations(), inventory.numTiles() - num_placed)) {
+        return false;   // DEAD END
+    }
+    
+    // Pick the frontier cell to branch on: cells a road or city runs into
+    // first, then the one with the fewest tiles that fit.  Only the
+    // bounding box of the layout and the ring around it is scanned.
+    int best_cell = -1;
+    int best_count = INT_MAX;
+    bool best_forced = false;
+    int last_row = std::min(bottom_row + 1, board.numRows() - 1);
+    int last_column = std::min(right_column + 1, board.numColumns() - 1);
+    for (int i = std::max(top_row - 1, 0); i <= last_row; ++i) {
+        for (int j = std::max(left_column - 1, 0); j <= last_column; ++j) {
+            int cell = board.index(i, j);
+            if (!Is_frontier(cell)) continue;
+            bool forced = Must_fill(cell);
+            int count = Count_candidates(cell);
+            if (forced && count == 0) return false;   // DEAD END
+            if (best_cell == -1 || (forced && !best_forced) ||
+                (forced == best_forced && count < best_count)) {
+                best_cell = cell;
+                best_count = count;
+                best_forced = forced;
+            }
+        }
+    }
+    // Tiles remain but the layout cannot grow any more.
+    if (best_cell == -1) return false;
+    
+    if (Try_tiles(best_cell, num_placed)) return true;
+    
+    // Otherwise leave the cell empty for the rest of this branch, unless a
+    // neighbor's road or city needs it.
+    if (best_forced) return false;
+    board.block(best_cell);
+    bool stop = Fill(num_placed);
+    if (!stop) board.unblock(best_cell);
+    return stop;
+}
+
+
+//---------------------------------------------------------------------
+// an open cell next to at least one placed tile
+bool CellSearch::Is_frontier(int cell) const {
+    return board.getCell(cell) == NULL && board.numPlacedNeighbors(cell) > 0;
+}
+
+
+//---------------------------------------------------------------------
+// true if a placed neighbor has a road or city edge facing the cell
+bool CellSearch::Must_fill(int cell) const {
+    return board.requiredEdges(cell) != 0;
+}
+
+
+//---------------------------------------------------------------------
+int CellSearch::Count_candidates(int cell) const {
+    int count = 0;
+    for (int kind = 0; kind < inventory.numKinds(); ++kind) {
+        if (remaining[kind] == 0) continue;
+        for (unsigned int fit = Fitting_orientations(cell, kind); fit != 0; fit &= fit - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+// ==========================================================================
+// SEARCH STATISTICS
+DepthStats::DepthStats() : nodes(0), corner_prunes(0), close_prunes(0), leaves(0), leaves_rejected(0), seconds(0) {
+    for (int r = 0; r < NUM_REJECT_REASONS; ++r) rejections[r] = 0;
+}
+
+
+// The time of a depth is split into the time spent at the depth itself
+// ("self") and below it ("total" is both).
+void SearchStats::Print(std::ostream &ostr) const {
+    static const char *columns[] = { "depth", "nodes", "corner", "close", "border", "north", "east",
+                                     "south", "west", "leaves", "bad_leaf", "total_s", "self_s" };
+    ostr << "Search statistics: " << nodes << " nodes\n";
+    if (depths.empty()) return;
+    for (int c = 0; c < sizeof(columns) / sizeof(columns[0]); ++c) ostr << std::setw(c == 0 ? 5 : 11) << columns[c];
+    ostr << "\n";
+    DepthStats sum;
+    for (int d = 0; d < depths.size(); ++d) {
+        const DepthStats &tmp = depths[d];
+        double below = (d + 1 < depths.size()) ? depths[d + 1].seconds : 0;
+        ostr << std::setw(5) << d << std::setw(11) << tmp.nodes
+             << std::setw(11) << tmp.corner_prunes << std::setw(11) << tmp.close_prunes;
+        for (int r = 0; r < NUM_REJECT_REASONS; ++r) {
+            ostr << std::setw(11) << tmp.rejections[r];
+            sum.rejections[r] += tmp.rejections[r];
+        }
+        ostr << std::setw(11) << tmp.leaves << std::setw(11) << tmp.leaves_rejected
+             << std::fixed << std::setprecision(6)
+             << std::setw(11) << tmp.seconds << std::setw(11) << tmp.seconds - below << "\n";
+        ostr.unsetf(std::ios::floatfield);
+        sum.nodes += tmp.nodes;
+        sum.corner_prunes += tmp.corner_prunes;
+        sum.close_prunes += tmp.close_prunes;
+        sum.leaves += tmp.leaves;
+        sum.leaves_rejected += tmp.leaves_rejected;
+    }
+    ostr << std::setw(5) << "all" << std::setw(11) << sum.nodes
+         << std::setw(11) << sum.corner_prunes << std::setw(11) << sum.close_prunes;
+    for (int r = 0; r < NUM_REJECT_REASONS; ++r) ostr << std::setw(11) << sum.rejections[r];
+    ostr << std::setw(11) << sum.leaves << std::setw(11) << sum.leaves_rejected
+         << std::fixed << std::setprecision(6) << std::setw(11) << depths[0].seconds
+         << std::setw(11) << depths[0].seconds << "\n";
+    ostr.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,222 @@
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "tile.h"
+#include "location.h"
+#include "board.h"
+#include "inventory.h"
+#include "memo.h"
+
+
+// Interface used by the searches to hand back every complete layout as
+// soon as it is found, so the search tree is only walked once.
+class SolutionVisitor {
+public:
+  virtual ~SolutionVisitor() {}
+  // Called with the board and locations of a valid layout. Return true
+  // to stop the search (the board is left holding this solution).
+  virtual bool Visit(const Board &board, const std::vector<Location> &locations) = 0;
+};
+
+
+// why Check_tile turned a tile down: a road or city edge on the border
+// of the board, or the first side that does not match its neighbor
+enum RejectReason { REJECT_BORDER, REJECT_NORTH, REJECT_EAST, REJECT_SOUTH, REJECT_WEST, NUM_REJECT_REASONS };
+
+// What the tile ordered search did at one depth (number of tiles placed).
+struct DepthStats {
+  DepthStats();
+  long long nodes;
+  long long rejections[NUM_REJECT_REASONS];
+  // nodes given up by Can_reach_corner and by Can_still_close
+  long long corner_prunes;
+  long long close_prunes;
+  // all the tiles placed, and of those the layouts Check_the_whole_board
+  // turned down
+  long long leaves;
+  long long leaves_rejected;
+  // wall time spent in the nodes at this depth, the deeper ones included
+  double seconds;
+};
+
+// What a search did, added up by the searches that are handed one (for
+// benchmarks and the -stats table), and how much it may do.
+struct SearchStats {
+  SearchStats(bool by_depth = false) :
+    nodes(0), per_depth(by_depth), node_limit(0), time_limit(0), out_of_budget(false),
+    start(std::chrono::steady_clock::now()) {}
+  // search nodes expanded
+  long long nodes;
+  // with per_depth, Can_place also fills in depths (and times every
+  // node, which costs a little)
+  bool per_depth;
+  std::vector<DepthStats> depths;
+
+  // The search stops (as if the visitor asked it to) instead of expanding
+  // more than node_limit nodes, or once it has run for time_limit seconds
+  // since the stats were made (0 for no limit).  out_of_budget is set
+  // then, so the solutions handed out are not all of them.
+  long long node_limit;
+  double time_limit;
+  bool out_of_budget;
+  std::chrono::steady_clock::time_point start;
+
+  // called by the searches before each node, true (for good) once a
+  // limit is reached; the clock is only read every 64 nodes
+  bool Over_budget() {
+    if (node_limit > 0 && nodes >= node_limit) out_of_budget = true;
+    if (time_limit > 0 && (nodes & 63) == 0 && Seconds() >= time_limit) out_of_budget = true;
+    return out_of_budget;
+  }
+  double Seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // a table of depths, one row per depth
+  void Print(std::ostream &ostr) const;
+};
+
+
+class SearchCheckpoint;
+
+
+// The set up every search of the tiles needs, whatever engine runs it.
+// A layout of t tiles spans at most t rows and t columns, and it can be
+// moved up and to the left until it touches the top left corner.  So the
+// board asked for (rows by columns) is cut down to t in each direction:
+// it still holds a copy of every layout, and the searches do not waste
+// time on the cells they could never reach.  Then only one of the
+// solutions that are the same up to a turn of the whole board is left to
+// search for (see TileInventory::breakRotationSymmetry).  rows and
+// columns are set to the board to search.
+void Prepare_search(TileInventory &inventory, int &rows, int &columns);
+
+// checks the layout of the whole board once all the tiles have been
+// placed, in O(1) from the board's counters
+bool Check_the_whole_board(const Board &board);
+
+// checks the edges of one tile against the border and its placed
+// neighbors, cell is a flat Board::index
+bool Check_tile(const Board &board, const Tile* tmp, int cell);
+
+// Bounds on what the tiles left can still do for the board: false if
+// the open road and city edges cannot all be closed by them (or the
+// pieces of the layout cannot all be joined), so the branch is dead
+// however the rest of the tiles are placed.
+bool Can_still_close(const Board &board, const EdgeSupply &supply, bool allow_rotations, int tiles_left);
+
+// Layouts are searched for in the top left corner of the board only (the
+// topmost tile in row 0, the leftmost one in column 0), every other
+// placement is a translated copy.  False if a layout whose tiles start at
+// top_row and left_column cannot get there any more.
+bool Can_reach_corner(int top_row, int left_column, int tiles_left);
+
+// Tile ordered search: places the tile at position "index" of the
+// inventory's kind by kind order on every cell that accepts it.
+// locations must hold one entry per tile, locations[t] is set to the
+// location of tile t.  Returns true if the visitor asked the search to stop
+// (or it ran out of the budget in stats).  The work done is added to
+// stats, if given (by depth, if it asks for it).  With a checkpoint the
+// search can be saved as it goes, and resumed (see checkpoint.h).
+bool Can_place(Board &board, const TileInventory &inventory, std::vector<Location> &locations,
+               int index, SolutionVisitor &visitor, SearchStats *stats = NULL,
+               SearchCheckpoint *checkpoint = NULL);
+
+
+// A node of the cell ordered search, recorded so that the subtree below
+// it can be searched later (possibly by another thread on its own board).
+struct SearchTask {
+  // one tile placed: its cell, its kind and orientation in the inventory
+  struct Placement {
+    int row, column, kind, orientation;
+  };
+  std::vector<Placement> placements;
+  // cells decided to stay empty, as row * columns + column
+  std::vector<int> blocked_cells;
+};
+
+
+// Cell ordered search: starting from an anchor tile it repeatedly picks
+// the most constrained empty cell next to the placed tiles, and either
+// puts one of the tiles left there or leaves the cell empty for good.
+// Layouts stay connected and edge matched as they grow, instead of being
+// checked only at the leaves.
+class CellSearch {
+public:
+  CellSearch(Board &board, const TileInventory &inventory);
+
+  // locations[t] is set to the location of tile t.  Returns true if the
+  // visitor asked the search to stop.
+  bool Search(std::vector<Location> &locations, SolutionVisitor &visitor);
+
+  // Walks the search only down to "depth" placed tiles and records every
+  // node reached there, instead of searching below it.
+  void Collect_tasks(int depth, std::vector<SearchTask> &tasks);
+
+  // Searches the subtree below a recorded node, same return as Search.
+  bool Resume(const SearchTask &task, std::vector<Location> &locations, SolutionVisitor &visitor);
+
+  // the search gives up (as if the visitor asked it to stop) once this
+  // flag is set, e.g. by another thread that found the answer
+  void setCancelFlag(const std::atomic<bool> *flag) { cancel = flag; }
+
+  // nodes found to have no solution below them are kept in this table and
+  // skipped when they are reached again (NULL, the default, for none);
+  // the board starts keeping its key then
+  void setMemo(TranspositionTable *table) {
+    memo = table;
+    if (memo != NULL) board.enableKeys();
+  }
+
+  // the work done is added to these, and the search stops like Can_place
+  // once they are out of budget (NULL, the default, for none)
+  void setStats(SearchStats *s) { stats = s; }
+
+private:
+
+  // HELPER FUNCTIONS
+  // cells are flat Board indices
+  bool Fill(int num_placed);
+  bool Expand(int num_placed);
+  bool Is_frontier(int cell) const;
+  bool Must_fill(int cell) const;
+  int Count_candidates(int cell) const;
+  bool Try_tiles(int cell, int num_placed);
+  unsigned int Fitting_orientations(int cell, int kind) const;
+  bool Search_anchors();
+  void Unblock_all();
+  void Grow_box(int row, int column);
+
+  // REPRESENTATION
+  Board &board;
+  const TileInventory &inventory;
+  // copies of each kind not placed yet, and their edges
+  std::vector<int> remaining;
+  EdgeSupply supply;
+  // tiles placed so far, in order
+  std::vector<SearchTask::Placement> placed;
+  // bounding box of the placed tiles, frontier cells are at most one
+  // cell outside of it
+  int top_row, bottom_row, left_column, right_column;
+  std::vector<Location> *locations;
+  SolutionVisitor *visitor;
+  const std::atomic<bool> *cancel;
+  // set while collecting tasks
+  std::vector<SearchTask> *tasks;
+  int task_depth;
+  TranspositionTable *memo;
+  // key of the tiles left, a random number per kind times its copies left
+  std::vector<unsigned long long> kind_keys;
+  unsigned long long remaining_key;
+  // search nodes expanded and solutions handed out, so far
+  long long num_nodes;
+  long long num_visits;
+  SearchStats *stats;
+};
+
+
+#endif
@@ -0,0 +1,148 @@
+// Checks that a tile ordered search saved and resumed under a node limit
+// gets to the end, with the same results as a search that runs in one go.
+// Build it from the puzzle directory, with every source file but
+// main.cpp, and run it there:
+//
+//   g++ -O2 -std=c++11 -pthread -o checkpoint_test tests/checkpoint_test.cpp $(ls *.cpp | grep -v main.cpp)
+//
+// Random puzzles (see puzzle_generator.h) are solved for all their
+// solutions, once without a limit and then as a chain of runs that each
+// resume from the checkpoint of the one before, with the same -node_limit
+// for every run.  Each run of the chain must get further than the one
+// before, and the last one must end with the solutions and the node count
+// of the search in one go.  Prints one line per puzzle and exits with 1
+// if any of them failed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../MersenneTwister.h"
+#include "../tile.h"
+#include "../location.h"
+#include "../board.h"
+#include "../inventory.h"
+#include "../solver.h"
+#include "../solution_set.h"
+#include "../checkpoint.h"
+#include "../puzzle_generator.h"
+
+
+// read by the tile and board code, the boards are never printed here
+int GLOBAL_TILE_SIZE = 11;
+
+
+// ==========================================================================
+// Keeps the distinct solutions, like -all_solutions.
+class AllVisitor : public CheckpointVisitor {
+public:
+  AllVisitor(const std::vector<Tile*> &tiles, bool allow_rotations) : results(tiles, allow_rotations) {}
+
+  bool Visit(const Board &board, const std::vector<Location> &locations) {
+    results.insert(locations);
+    return false; // keep going
+  }
+
+  int numDistinct() const { return results.size(); }
+
+  void Save(std::ostream &ostr) const { results.Save(ostr); }
+  bool Load(std::istream &istr) { return results.Load(istr); }
+
+private:
+  SolutionSet results;
+};
+
+
+// ==========================================================================
+// Runs the search once, from the checkpoint file if resume is set, and
+// saves to the file where it stops.  Returns false if it could not resume.
+bool Run(const std::vector<Tile*> &tiles, const TileInventory &inventory, int rows, int columns,
+         long long node_limit, const std::string &filename, bool resume, SearchStats &stats, int &num_solutions) {
+  Board board(rows, columns);
+  std::vector<Location> locations(inventory.numTiles());
+  AllVisitor visitor(tiles, inventory.allowsRotations());
+  SearchCheckpoint checkpoint(tiles, rows, columns, inventory.allowsRotations(), visitor);
+  stats.node_limit = node_limit;
+  if (resume && !checkpoint.Resume(filename, &stats)) return false;
+  // only saved when it runs out of nodes
+  checkpoint.setFile(filename, 1e9);
+  Can_place(board, inventory, locations, 0, visitor, &stats, &checkpoint);
+  num_solutions = visitor.numDistinct();
+  return true;
+}
+
+
+// ==========================================================================
+// Solves one puzzle in one go and as a chain, true if they agree.
+bool Test_puzzle(const PuzzleFamily &family, unsigned long seed, long long node_limit, const std::string &filename) {
+  MTRand mtrand(seed);
+  std::vector<EdgeCode> codes;
+  GeneratePuzzle(family, mtrand, codes);
+  std::vector<Tile*> tiles;
+  for (int t = 0; t < codes.size(); t++) {
+    tiles.push_back(new Tile(codes[t]));
+  }
+  TileInventory inventory(tiles, family.allow_rotations);
+  int rows = family.rows;
+  int columns = family.columns;
+  Prepare_search(inventory, rows, columns);
+
+  SearchStats full_stats;
+  int full_solutions = 0;
+  Run(tiles, inventory, rows, columns, 0, filename, false, full_stats, full_solutions);
+
+  // every run has to expand at least node_limit nodes but the last one
+  int max_runs = full_stats.nodes / node_limit + 2;
+  SearchStats stats;
+  int solutions = 0;
+  int runs = 0;
+  long long last_nodes = -1;
+  bool ok = true;
+  std::remove(filename.c_str());
+  do {
+    stats = SearchStats();
+    if (!Run(tiles, inventory, rows, columns, node_limit, filename, runs > 0, stats, solutions) ||
+        stats.nodes <= last_nodes) {
+      ok = false;
+      break;
+    }
+    last_nodes = stats.nodes;
+    runs++;
+  } while (stats.out_of_budget && runs <= max_runs);
+  std::remove(filename.c_str());
+  ok = ok && !stats.out_of_budget && solutions == full_solutions && stats.nodes == full_stats.nodes;
+
+  std::cout << (ok ? "ok  " : "FAIL") << "  seed " << seed << ": " << full_solutions << " solutions, "
+            << full_stats.nodes << " nodes in one go, " << solutions << " solutions, " << stats.nodes
+            << " nodes after " << runs << " runs of " << node_limit << " nodes" << std::endl;
+
+  for (int t = 0; t < tiles.size(); t++) {
+    delete tiles[t];
+  }
+  return ok;
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+  std::string filename = "checkpoint_test.ck";
+  PuzzleFamily family;
+  family.num_tiles = 7;
+  family.rows = 4;
+  family.columns = 4;
+  family.duplicate_ratio = 0.25;
+  family.allow_rotations = true;
+
+  bool ok = true;
+  for (unsigned long seed = 1; seed <= 5; seed++) {
+    ok = Test_puzzle(family, seed, 5000, filename) && ok;
+  }
+  // a limit smaller than the path back down to the saved node
+  family.num_tiles = 5;
+  family.rows = 3;
+  family.columns = 3;
+  ok = Test_puzzle(family, 6, 3, filename) && ok;
+  return ok ? 0 : 1;
+}
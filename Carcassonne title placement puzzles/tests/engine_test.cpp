@@ -0,0 +1,118 @@
+// Checks that every engine finds the same solutions of a puzzle: the tile
+// ordered search, the cell ordered search (alone, with a memo and on
+// several threads) and exact cover.  Build it from the puzzle directory,
+// with every source file but main.cpp, and run it there:
+//
+//   g++ -O2 -std=c++11 -pthread -o engine_test tests/engine_test.cpp $(ls *.cpp | grep -v main.cpp)
+//
+// The puzzles are one without tiles (its one solution is the empty
+// layout) and random ones (see puzzle_generator.h), with and without
+// rotations.  Each is solved for all its solutions and counted; prints
+// one line per puzzle and exits with 1 if the engines did not agree on
+// any of them.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../MersenneTwister.h"
+#include "../tile.h"
+#include "../location.h"
+#include "../board.h"
+#include "../inventory.h"
+#include "../solver.h"
+#include "../solution_set.h"
+#include "../parallel.h"
+#include "../dlx.h"
+#include "../puzzle_generator.h"
+
+
+// read by the tile and board code, the boards are never printed here
+int GLOBAL_TILE_SIZE = 11;
+
+
+static const int NUM_ENGINES = 5;
+static const char* ENGINE_NAMES[NUM_ENGINES] = { "tiles", "cells", "memo", "threads", "dlx" };
+
+
+// ==========================================================================
+// The number of solutions one engine finds in the mode.
+long long Solve(const std::vector<Tile*> &tiles, const TileInventory &inventory, int rows, int columns,
+                int engine, SolutionMode mode) {
+  Board board(rows, columns);
+  std::vector<Location> locations;
+  SolutionTally visitor(mode, tiles, inventory, rows, columns);
+  if (engine == 0) {
+    locations.assign(inventory.numTiles(), Location());
+    Can_place(board, inventory, locations, 0, visitor);
+  } else if (engine == 1 || engine == 2) {
+    CellSearch search(board, inventory);
+    TranspositionTable memo(1);
+    if (engine == 2) search.setMemo(&memo);
+    search.Search(locations, visitor);
+  } else if (engine == 3) {
+    ParallelSearch search(rows, columns, inventory, 3, 2);
+    search.Search(visitor);
+  } else {
+    ExactCoverSearch search(board, inventory);
+    search.Search(locations, visitor);
+  }
+  return visitor.numSolutions();
+}
+
+
+// ==========================================================================
+// Solves the puzzle with every engine, true if they all agree.
+bool Test_puzzle(const std::string &name, const std::vector<EdgeCode> &codes, int rows, int columns,
+                 bool allow_rotations) {
+  std::vector<Tile*> tiles;
+  for (int t = 0; t < codes.size(); t++) {
+    tiles.push_back(new Tile(codes[t]));
+  }
+  TileInventory inventory(tiles, allow_rotations);
+  Prepare_search(inventory, rows, columns);
+
+  bool ok = true;
+  std::cout << name;
+  SolutionMode modes[2] = { ALL_SOLUTIONS, COUNT_SOLUTIONS };
+  for (int m = 0; m < 2; m++) {
+    std::cout << (modes[m] == ALL_SOLUTIONS ? "  all:" : "  count:");
+    long long expected = -1;
+    for (int e = 0; e < NUM_ENGINES; e++) {
+      long long found = Solve(tiles, inventory, rows, columns, e, modes[m]);
+      if (expected == -1) expected = found;
+      if (found != expected) ok = false;
+      std::cout << " " << ENGINE_NAMES[e] << " " << found;
+    }
+  }
+  std::cout << (ok ? "  ok" : "  FAIL") << std::endl;
+
+  for (int t = 0; t < tiles.size(); t++) {
+    delete tiles[t];
+  }
+  return ok;
+}
+
+
+// ==========================================================================
+int main(int argc, char *argv[]) {
+  bool ok = true;
+  // no tiles at all: the empty layout, whatever the engine
+  ok = Test_puzzle("empty", std::vector<EdgeCode>(), 2, 2, false) && ok;
+  ok = Test_puzzle("empty, rotations", std::vector<EdgeCode>(), 2, 2, true) && ok;
+
+  PuzzleFamily family;
+  family.num_tiles = 6;
+  family.rows = 4;
+  family.columns = 4;
+  family.duplicate_ratio = 0.25;
+  for (unsigned long seed = 1; seed <= 6; seed++) {
+    family.allow_rotations = (seed % 2 == 0);
+    MTRand mtrand(seed);
+    std::vector<EdgeCode> codes;
+    GeneratePuzzle(family, mtrand, codes);
+    std::string name = std::string("seed ") + char('0' + seed) + (family.allow_rotations ? ", rotations" : "");
+    ok = Test_puzzle(name, codes, family.rows, family.columns, family.allow_rotations) && ok;
+  }
+  return ok ? 0 : 1;
+}
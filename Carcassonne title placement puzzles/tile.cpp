@@ -1,5 +1,8 @@
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <string>
 #include "tile.h"
@@ -16,42 +19,82 @@
 extern int GLOBAL_TILE_SIZE;
 
 
+// ==========================================================================
+EdgeType edgeFromString(const std::string &edge) {
+  if (edge == "city") return CITY;
+  if (edge == "road") return ROAD;
+  assert (edge == "pasture");
+  return PASTURE;
+}
+
+const char* edgeName(EdgeType edge) {
+  if (edge == CITY) return "city";
+  if (edge == ROAD) return "road";
+  assert (edge == PASTURE);
+  return "pasture";
+}
+
+
 // ==========================================================================
 // CONSTRUCTOR
 // takes in 4 strings, checks the legality of the labeling 
 Tile::Tile(const std::string &north, const std::string &east,
            const std::string &south, const std::string &west) :
-  north_(north), east_(east), south_(south), west_(west) {
+  ascii_art(NULL), art_size(0) {
 
   // check the input strings
-  assert (north_ == "city" || north_ == "road" || north_ == "pasture");
-  assert (east_  == "city" || east_  == "road" || east_  == "pasture");
-  assert (south_ == "city" || south_ == "road" || south_ == "pasture");
-  assert (west_  == "city" || west_  == "road" || west_  == "pasture");
+  assert (north == "city" || north == "road" || north == "pasture");
+  assert (east  == "city" || east  == "road" || east  == "pasture");
+  assert (south == "city" || south == "road" || south == "pasture");
+  assert (west  == "city" || west  == "road" || west  == "pasture");
+
+  // pack the edges for the fast comparisons done by the solver
+  code_ = EdgeCode(edgeFromString(north) << (2*NORTH) |
+                   edgeFromString(east)  << (2*EAST)  |
+                   edgeFromString(south) << (2*SOUTH) |
+                   edgeFromString(west)  << (2*WEST));
+
+  // For our version of Carcassonne, we put restrictions on the tile edge
+  // labeling (see checkCode)
+  assert (checkCode(code_) == NULL);
+  count_edges();
+}
+
+// takes in the packed edges, which must be legal
+Tile::Tile(EdgeCode code) : code_(code), ascii_art(NULL), art_size(0) {
+  assert (checkCode(code) == NULL);
+  count_edges();
+}
+
 
-  // count the number of cities and roads
+// count the number of cities and roads
+void Tile::count_edges() {
   num_cities = 0;
-  if (north_ == "city") num_cities++;
-  if (south_ == "city") num_cities++;
-  if (east_ == "city") num_cities++;
-  if (west_ == "city") num_cities++;
   num_roads = 0;
-  if (north_ == "road") num_roads++;
-  if (south_ == "road") num_roads++;
-  if (east_ == "road") num_roads++;
-  if (west_ == "road") num_roads++;
-  
-  // For our version of Carcassonne, we put these restrictions on the
-  // tile edge labeling:
-  if (num_roads == 1) {
-    assert (num_cities == 0 || num_cities == 3);
-  }
-  if (num_roads == 2 && num_cities == 2) {
-    assert (north_ == east_ || north_ == west_);
+  for (int side = NORTH; side <= WEST; side++) {
+    if (getEdge(code_, side) == CITY) num_cities++;
+    if (getEdge(code_, side) == ROAD) num_roads++;
   }
+}
+
 
-  // pre-compute the ASCII art center of the tile
-  prepare_ascii_art();
+// the same restrictions as above
+const char* Tile::checkCode(EdgeCode code) {
+  int cities = 0;
+  int roads = 0;
+  for (int side = NORTH; side <= WEST; side++) {
+    if (getEdge(code, side) == CITY) cities++;
+    else if (getEdge(code, side) == ROAD) roads++;
+    else if (getEdge(code, side) != PASTURE) return "bad edge value";
+  }
+  if (roads == 1 && cities != 0 && cities != 3) {
+    return "a tile with one road must have no city or three city edges";
+  }
+  if (roads == 2 && cities == 2 && getEdge(code, NORTH) != getEdge(code, EAST) &&
+      getEdge(code, NORTH) != getEdge(code, WEST)) {
+    return "the two cities of a tile with two roads must be next to each other";
+  }
+  return NULL;
 }
 
 
@@ -59,21 +102,63 @@ Tile::Tile(const std::string &north, const std::string &east,
 // print one row of the tile at a time 
 // (allows a whole board of tiles to be printed)
 void Tile::printRow(std::ostream &ostr, int row) const {
+  std::vector<char> buffer(GLOBAL_TILE_SIZE);
+  renderRow(&buffer[0], row);
+  ostr.write(&buffer[0], GLOBAL_TILE_SIZE);
+}
+
+
+void Tile::renderRow(char *out, int row) const {
   // must be a legal row for this tile size
   assert (row >= 0 && row < GLOBAL_TILE_SIZE);
 
+  // look up the ASCII art center of the tile on first use (again if the
+  // tile size has changed since)
+  if (ascii_art == NULL || art_size != GLOBAL_TILE_SIZE) {
+    ascii_art = &shared_ascii_art();
+    art_size = GLOBAL_TILE_SIZE;
+  }
+
   if (row == 0 || row == GLOBAL_TILE_SIZE-1) {
-    ostr << '+' << std::string(GLOBAL_TILE_SIZE-2,'-') << '+';
+    out[0] = '+';
+    memset(out+1, '-', GLOBAL_TILE_SIZE-2);
   } else {
-    ostr << '|' << ascii_art[row-1] << '|';
+    out[0] = '|';
+    memcpy(out+1, (*ascii_art)[row-1].data(), GLOBAL_TILE_SIZE-2);
+  }
+  out[GLOBAL_TILE_SIZE-1] = out[0];
+}
+
+
+char Tile::compactChar() const {
+  if (hasAbbey()) return 'A';
+  if (num_cities > 0) return 'C';
+  return 'R';
+}
+
+
+// ==========================================================================
+// The art only depends on the edges and the tile size, so it is built once
+// per edge code and size and shared by every tile that looks the same
+// (e.g. the copies of a tile, and the rotations the solver makes).  It is
+// locked so threads can look it up at the same time (the parallel search
+// hands its boards to the visitor from the worker threads).
+const std::vector<std::string>& Tile::shared_ascii_art() const {
+  static std::map<int, std::vector<std::string> > table;
+  static std::mutex lock;
+  std::lock_guard<std::mutex> guard(lock);
+  std::vector<std::string> &art = table[GLOBAL_TILE_SIZE * 256 + code_];
+  if (art.empty()) {
+    prepare_ascii_art(art);
   }
+  return art;
 }
 
 
 // ==========================================================================
 // long, messy, uninteresting function that
 // prepares the inner block of ASCII art for the tile
-void Tile::prepare_ascii_art() {
+void Tile::prepare_ascii_art(std::vector<std::string> &ascii_art) const {
 
   // tiles have to be odd sized
   assert (GLOBAL_TILE_SIZE % 2 == 1);
@@ -87,20 +172,24 @@ void Tile::prepare_ascii_art() {
   assert (city_depth >= 3);
   int road_curve = city_depth-1;
   ascii_art = std::vector<std::string>(inner_size,std::string(inner_size,' '));
+  EdgeType north = getEdge(code_, NORTH);
+  EdgeType east = getEdge(code_, EAST);
+  EdgeType south = getEdge(code_, SOUTH);
+  EdgeType west = getEdge(code_, WEST);
 
   // -------------------------------------------------------------------
   // ROADS
 
   // Does a road go straight vertically or horizontally through the tile?
   bool center_road = false;
-  if ((north_ == "road" && south_ == "road") ||
-       (east_ == "road" && west_ == "road")) {
+  if ((north == ROAD && south == ROAD) ||
+       (east == ROAD && west == ROAD)) {
     center_road = true;
     ascii_art[half][half] = ROAD_CHAR;
   }
 
   // Construct the road fragments from edge towards the center of the tile
-  if (north_ == "road") {
+  if (north == ROAD) {
     for (int i = 0; i < half-1; i++) {
       ascii_art[i][half] = ROAD_CHAR;
     }
@@ -108,7 +197,7 @@ void Tile::prepare_ascii_art() {
       ascii_art[half-1][half] = ROAD_CHAR;
     }
   }
-  if (south_ == "road") {
+  if (south == ROAD) {
     for (int i = half+2; i < inner_size; i++) {
       ascii_art[i][half] = ROAD_CHAR;
     }
@@ -116,7 +205,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half+1][half] = ROAD_CHAR;
     }
   }
-  if (west_ == "road") {
+  if (west == ROAD) {
     for (int i = 0; i < half-1; i++) {
       ascii_art[half][i] = ROAD_CHAR;
     }
@@ -124,7 +213,7 @@ void Tile::prepare_ascii_art() {
       ascii_art[half][half-1] = ROAD_CHAR;
     }
   }
-  if (east_ == "road") {
+  if (east == ROAD) {
     for (int i = half+2; i < inner_size; i++) {
       ascii_art[half][i] = ROAD_CHAR;
     }
@@ -135,7 +224,7 @@ void Tile::prepare_ascii_art() {
 
   // Construct the curved pieces of "corner" roads
   if (!center_road) {
-    if (north_ == "road" && east_ == "road") {
+    if (north == ROAD && east == ROAD) {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half-c][half+road_curve-c] = ROAD_CHAR;
         ascii_art[half-c][half+road_curve-c] = ROAD_CHAR;
@@ -143,7 +232,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half][half+road_curve-c] = ' ';
       }
     }
-    if (east_ == "road" && south_ == "road") {
+    if (east == ROAD && south == ROAD) {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half+c][half+road_curve-c] = ROAD_CHAR;
         ascii_art[half+c][half+road_curve-c] = ROAD_CHAR;
@@ -151,7 +240,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half][half+road_curve-c] = ' ';
       }
     }
-    if (south_ == "road" && west_ == "road") {
+    if (south == ROAD && west == ROAD) {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half+c][half-road_curve+c] = ROAD_CHAR;
         ascii_art[half+c][half-road_curve+c] = ROAD_CHAR;
@@ -159,7 +248,7 @@ void Tile::prepare_ascii_art() {
         ascii_art[half][half-road_curve+c] = ' ';
       }
     }
-    if (west_ == "road" && north_ == "road") {
+    if (west == ROAD && north == ROAD) {
       for (int c = 1; c < road_curve; c++) {
         ascii_art[half-c][half-road_curve+c] = ROAD_CHAR;
         ascii_art[half-c][half-road_curve+c] = ROAD_CHAR;
@@ -173,9 +262,9 @@ void Tile::prepare_ascii_art() {
   // -------------------------------------------------------------------
   // CITIES
   // construct the curved wedges of cities for each edge
-  if (north_ == "city") {
+  if (north == CITY) {
     int depth = city_depth;
-    if (east_ == "city" || west_ == "city") {
+    if (east == CITY || west == CITY) {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
@@ -184,9 +273,9 @@ void Tile::prepare_ascii_art() {
       }
     }
   }
-  if (south_ == "city") {
+  if (south == CITY) {
     int depth = city_depth;
-    if (east_ == "city" || west_ == "city") {
+    if (east == CITY || west == CITY) {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
@@ -195,9 +284,9 @@ void Tile::prepare_ascii_art() {
       }
     }
   }
-  if (west_ == "city") {
+  if (west == CITY) {
     int depth = city_depth;
-    if (north_ == "city" || south_ == "city") {
+    if (north == CITY || south == CITY) {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
@@ -206,9 +295,9 @@ void Tile::prepare_ascii_art() {
       }
     }
   }
-  if (east_ == "city") {
+  if (east == CITY) {
     int depth = city_depth;
-    if (north_ == "city" || south_ == "city") {
+    if (north == CITY || south == CITY) {
       depth = half;
     }
     for (int i = 0; i < depth; i++) {
@@ -228,22 +317,22 @@ void Tile::prepare_ascii_art() {
   } 
 
   // If there are 2 neighboring wedges of city, fill in the gap
-  if (north_ == "city" && west_ == "city") {
+  if (north == CITY && west == CITY) {
     for (int i = 0; i < half; i++) {
       ascii_art[i][i] = CITY_CHAR;
     }
   }
-  if (north_ == "city" && east_ == "city") {
+  if (north == CITY && east == CITY) {
     for (int i = 0; i < half; i++) {
       ascii_art[i][GLOBAL_TILE_SIZE-3-i] = CITY_CHAR;
     }
   }
-  if (south_ == "city" && west_ == "city") {
+  if (south == CITY && west == CITY) {
     for (int i = 0; i < half; i++) {
       ascii_art[GLOBAL_TILE_SIZE-3-i][i] = CITY_CHAR;
     }
   }
-  if (south_ == "city" && east_ == "city") {
+  if (south == CITY && east == CITY) {
     for (int i = 0; i < half; i++) {
       ascii_art[GLOBAL_TILE_SIZE-3-i][GLOBAL_TILE_SIZE-3-i] = CITY_CHAR;
     }
@@ -6,6 +6,26 @@
 #include <vector>
 
 
+// Compact edge encoding: each edge takes 2 bits and the four edges of a
+// tile are packed into one byte, north in the low bits then east, south
+// and west.  Rotating a tile 90 degrees clockwise is a 2 bit rotate left.
+enum EdgeType { PASTURE = 0, ROAD = 1, CITY = 2 };
+enum Side { NORTH = 0, EAST = 1, SOUTH = 2, WEST = 3 };
+typedef unsigned char EdgeCode;
+
+inline EdgeType getEdge(EdgeCode code, int side) { return EdgeType((code >> (2*side)) & 3); }
+inline int oppositeSide(int side) { return (side + 2) & 3; }
+inline EdgeCode rotateCode(EdgeCode code, int quarter_turns) {
+  int n = 2 * (quarter_turns & 3);
+  return EdgeCode((code << n) | (code >> (8 - n)));
+}
+
+// converts "pasture", "road" or "city" to its edge code
+EdgeType edgeFromString(const std::string &edge);
+// and back
+const char* edgeName(EdgeType edge);
+
+
 // This class represents a single Carcassonne tile and includes code
 // to produce a human-readable ASCII art representation of the tile.
 
@@ -15,32 +35,49 @@ public:
   // Constructor takes in 4 strings, representing what is on the edge
   // of each tile.  Each edge string is "pasture", "road", or "city".
   Tile(const std::string &north, const std::string &east, const std::string &south, const std::string &west);
+  // Same, from the packed edges
+  Tile(EdgeCode code);
+
+  // NULL if the edges are a legal labeling for our version of
+  // Carcassonne, otherwise what is wrong with them
+  static const char* checkCode(EdgeCode code);
 
   // ACCESSORS
-  const std::string& getNorth() const { return north_; }
-  const std::string& getSouth() const { return south_; }
-  const std::string& getEast() const { return east_; }
-  const std::string& getWest() const { return west_; }
+  // the edge names ("pasture", "road" or "city"), made from the code
+  std::string getNorth() const { return edgeName(getEdge(code_, NORTH)); }
+  std::string getSouth() const { return edgeName(getEdge(code_, SOUTH)); }
+  std::string getEast() const { return edgeName(getEdge(code_, EAST)); }
+  std::string getWest() const { return edgeName(getEdge(code_, WEST)); }
+  EdgeCode getCode() const { return code_; }
   int numCities() const { return num_cities; }
   int numRoads() const { return num_roads; }
   int hasAbbey() const { return (num_cities == 0 && num_roads <= 1); }
 
   // for ASCII art printing
   void printRow(std::ostream &ostr, int i) const;
+  // writes row i of the art into out (GLOBAL_TILE_SIZE chars, no '\0')
+  void renderRow(char *out, int i) const;
+  // one character standing for the tile: A(bbey), C(ity) or R(oad)
+  char compactChar() const;
 
 private:
 
-  // helper function called by the constructor for printing
-  void prepare_ascii_art();
+  // helper functions
+  void count_edges();
+  // called the first time the tile is printed
+  const std::vector<std::string>& shared_ascii_art() const;
+  void prepare_ascii_art(std::vector<std::string> &ascii_art) const;
 
   // REPRESENTATION
-  std::string north_;
-  std::string east_;
-  std::string south_;
-  std::string west_;
+  // the edges are only kept packed, building a tile from its code is a
+  // few shifts
+  EdgeCode code_;
   int num_roads;
   int num_cities;
-  std::vector<std::string> ascii_art;
+  // found lazily, most tiles (e.g. rotations the solver tries) are never
+  // printed, and shared between the tiles with the same edges
+  mutable const std::vector<std::string> *ascii_art;
+  mutable int art_size;
 };
 
 
@@ -0,0 +1,160 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tile_file.h"
+
+
+// at most this many malformed lines are listed, then only their number
+static const int MAX_REPORTED_ERRORS = 20;
+
+
+// ==========================================================================
+// The contents of a file, memory mapped if possible (read into a buffer
+// otherwise, e.g. for an empty file or a pipe).
+class FileContents {
+public:
+  FileContents(const std::string &filename) : data(NULL), size(0), ok(false), mapped(NULL) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      struct stat info;
+      if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *p = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+          mapped = p;
+          data = (const char*)p;
+          size = info.st_size;
+          ok = true;
+        }
+      }
+      close(fd);
+    }
+    if (ok) return;
+    std::ifstream istr(filename.c_str(), std::ios::binary);
+    if (!istr) return;
+    buffer.assign(std::istreambuf_iterator<char>(istr), std::istreambuf_iterator<char>());
+    data = buffer.empty() ? "" : &buffer[0];
+    size = buffer.size();
+    ok = true;
+  }
+
+  ~FileContents() {
+    if (mapped != NULL) munmap(mapped, size);
+  }
+
+  // REPRESENTATION
+  const char *data;
+  size_t size;
+  bool ok;
+
+private:
+  // prevent copying, we own the mapping
+  FileContents(const FileContents &);
+  FileContents& operator=(const FileContents &);
+
+  void *mapped;
+  std::vector<char> buffer;
+};
+
+
+// ==========================================================================
+// the edge named by the token, or -1
+static int Edge_token(const char *token, int length) {
+  if (length == 4 && memcmp(token, "city", 4) == 0) return CITY;
+  if (length == 4 && memcmp(token, "road", 4) == 0) return ROAD;
+  if (length == 7 && memcmp(token, "pasture", 7) == 0) return PASTURE;
+  return -1;
+}
+
+
+static bool Is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+
+// ==========================================================================
+bool ReadTileFile(const std::string &filename, std::vector<Tile*> &tiles) {
+  FileContents file(filename);
+  if (!file.ok) {
+    std::cerr << "ERROR: cannot open file '" << filename << "'" << std::endl;
+    return false;
+  }
+
+  std::vector<EdgeCode> codes;
+  int num_errors = 0;
+  const char *p = file.data;
+  const char *end = file.data + file.size;
+  for (int line = 1; p < end; line++) {
+    const char *line_end = (const char*)memchr(p, '\n', end - p);
+    if (line_end == NULL) line_end = end;
+
+    // split the line into at most 6 tokens, the 6th is an error
+    const char *token[6];
+    int length[6];
+    int num_tokens = 0;
+    while (num_tokens < 6) {
+      while (p < line_end && Is_space(*p)) p++;
+      if (p == line_end) break;
+      token[num_tokens] = p;
+      while (p < line_end && !Is_space(*p)) p++;
+      length[num_tokens] = p - token[num_tokens];
+      num_tokens++;
+    }
+    p = line_end + 1;
+    if (num_tokens == 0) continue;
+
+    // the line is checked, the first problem found is reported
+    std::string error;
+    int edges[4];
+    if (length[0] != 4 || memcmp(token[0], "tile", 4) != 0) {
+      error = "expected 'tile', found '" + std::string(token[0], length[0]) + "'";
+    } else if (num_tokens != 5) {
+      error = (num_tokens < 5) ? "expected 4 edges after 'tile'" : "unexpected text after the 4 edges";
+    } else {
+      for (int side = NORTH; side <= WEST && error.empty(); side++) {
+        edges[side] = Edge_token(token[side + 1], length[side + 1]);
+        if (edges[side] == -1) {
+          error = "unknown edge '" + std::string(token[side + 1], length[side + 1]) +
+            "' (expected pasture, road or city)";
+        }
+      }
+    }
+    EdgeCode code = 0;
+    if (error.empty()) {
+      for (int side = NORTH; side <= WEST; side++) {
+        code |= edges[side] << (2 * side);
+      }
+      const char *illegal = Tile::checkCode(code);
+      if (illegal != NULL) error = illegal;
+    }
+
+    if (!error.empty()) {
+      if (num_errors < MAX_REPORTED_ERRORS) {
+        std::cerr << "ERROR: " << filename << ":" << line << ": " << error << std::endl;
+      }
+      num_errors++;
+      continue;
+    }
+    codes.push_back(code);
+  }
+
+  if (num_errors > MAX_REPORTED_ERRORS) {
+    std::cerr << "ERROR: " << filename << ": " << num_errors - MAX_REPORTED_ERRORS
+              << " more malformed lines" << std::endl;
+  }
+  if (num_errors > 0) return false;
+
+  tiles.reserve(tiles.size() + codes.size());
+  for (int t = 0; t < codes.size(); t++) {
+    tiles.push_back(new Tile(codes[t]));
+  }
+  return true;
+}
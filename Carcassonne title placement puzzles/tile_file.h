@@ -0,0 +1,24 @@
+#ifndef __TILE_FILE_H__
+#define __TILE_FILE_H__
+
+#include <string>
+#include <vector>
+#include "tile.h"
+
+
+// Reads a puzzle file, one tile per line:
+//
+//   tile <north> <east> <south> <west>
+//
+// with every edge "pasture", "road" or "city".  Blank lines are skipped.
+// The file is memory mapped and scanned in place, the edge names go
+// straight into edge codes and no string is made per token.
+//
+// Malformed lines (unknown words, missing or extra edges, labelings that
+// are not legal tiles, see Tile::checkCode) are reported to std::cerr
+// with their line number.  Returns false if the file cannot be read or
+// has any malformed line, no tiles are added then.
+bool ReadTileFile(const std::string &filename, std::vector<Tile*> &tiles);
+
+
+#endif